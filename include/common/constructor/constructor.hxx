@@ -8,6 +8,9 @@ class Constructor {
 public:
     static MeshModel Cubic(Point3d point1, Point3d Point2d);
 
+    // the unit cube stretched over the two corners by its transform, all the boxes made this way share their vertices
+    static MeshModel PlacedCubic(Point3d point1, Point3d point2);
+
     static MeshModel Sphere(Point3d center, float radius);
 
     static MeshModel Rectangle(glm::vec3 left_bot, glm::vec3 left_top, glm::vec3 right_bot);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// the pixels of a decoded image as stbi_load returns them, the rows from the top of the file
+struct Image {
+    // the path the image was first read from
+    std::string path;
+
+    // hash of the bytes of the file
+    uint64_t content_hash {0};
+
+    int width {0}, height {0}, num_channels {0};
+    unsigned char *pixels {nullptr};
+
+    Image() = default;
+
+    Image(const Image &) = delete;
+    Image &operator = (const Image &) = delete;
+
+    ~Image();
+};
+
+// an image stays decoded as long as a handle to it is held
+using ImageHandle = std::shared_ptr<const Image>;
+
+/*
+ * The decoded images of the process, shared by the GL textures, the skybox and the ray tracer. An image is found
+ * by its path, a path not seen yet is read and found by the hash of its bytes, so the copies of one file under
+ * several paths are decoded once. The cache only holds weak references: an image no longer used is freed, and
+ * decoded again on the next load. The files are assumed not to change while the process runs.
+ *
+ * Loads may come from any thread.
+ */
+class ImageCache {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::weak_ptr<const Image>> by_path;
+    std::unordered_map<uint64_t, std::weak_ptr<const Image>> by_content;
+
+    // the image already known for the path, null if there is none, the mutex must be held
+    ImageHandle find_path(const std::string &path) const;
+
+    // reads the file and decodes it unless an image of the same bytes is cached, the mutex is not held while decoding
+    ImageHandle load_file(const std::string &path);
+
+public:
+    // the cache of the process
+    static ImageCache &instance();
+
+    // null when the file cannot be read or decoded
+    ImageHandle load(const std::string &path);
+
+    /*
+     * the images of all the paths in their order, the ones not cached are decoded on thread_count threads,
+     * zero stands for the hardware concurrency
+     */
+    std::vector<ImageHandle> load(const std::vector<std::string> &paths, int thread_count = 0);
+
+    // number of images alive
+    size_t size();
+};
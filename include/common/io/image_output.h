@@ -0,0 +1,53 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include "common/ray_tracing/framebuffer.h"
+
+enum class ImageFormat {
+    // chosen from the extension of the path, binary ppm for streams and unknown extensions
+    automatic,
+    // binary 8 bit rgb, P6
+    ppm,
+    // 32 bit float rgb, the Portable Float Map
+    pfm,
+    // 8 bit rgb
+    png,
+    // Radiance rgbe
+    hdr
+};
+
+enum class ToneMapping {
+    // values outside [0, 1] are clamped
+    clamp,
+    // c / (1 + c)
+    reinhard,
+    // the ACES filmic curve fit of Krzysztof Narkowicz
+    aces
+};
+
+/*
+ * The 8 bit formats go through exposure, tone mapping and the optional sRGB curve.
+ * The float formats only apply the exposure and keep the linear values.
+ */
+struct ImageOutputSettings {
+    ImageFormat format {ImageFormat::automatic};
+    ToneMapping tone_mapping {ToneMapping::clamp};
+    float exposure {1.0f};
+    bool srgb {false};
+
+    // channel of the framebuffer to write, a single component channel is written as gray
+    std::string channel {"color"};
+
+    // rows are encoded in chunks of chunk_rows on thread_count threads, zero stands for the hardware concurrency
+    int thread_count {0};
+    int chunk_rows {64};
+};
+
+ImageFormat image_format_from_path(const std::string &path);
+
+// returns false if the channel does not exist or the stream fails
+bool write_image(const FrameBuffer &framebuffer, std::ostream &stream, const ImageOutputSettings &settings = {});
+
+bool write_image(const FrameBuffer &framebuffer, const std::string &path, const ImageOutputSettings &settings = {});
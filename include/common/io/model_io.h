@@ -10,7 +10,12 @@
 class ModelIO {
     std::string directory;
 
+    // textures are uploaded to GL when true, otherwise they are only read into memory
+    bool upload_textures;
+
     public:
+        explicit ModelIO(bool t_upload_textures = true): upload_textures(t_upload_textures) {}
+
         std::vector<MeshModel> read_obj_model(std::string model_path);
 
     void load_material_texture(aiMaterial *material, aiTextureType type, MeshModel &model);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <fstream>
 #include "glm/vec3.hpp"
 
 template<size_t n, size_t m>
@@ -15,8 +16,8 @@ void output_ppm_image(const std::array<std::array<glm::vec3, m>, n> &image) {
             pixel.x *= 255.99;
             pixel.y *= 255.99;
             pixel.z *= 255.99;
-            file << int(pixel.x) << ' ' << int(pixel.y) << ' ' << int(pixel.z) << std::endl;
+            file << int(pixel.x) << ' ' << int(pixel.y) << ' ' << int(pixel.z) << '\n';
         }
     }
     file.close();
-}
\ No newline at end of file
+}
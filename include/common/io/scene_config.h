@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/mesh_model.hxx"
+
+/*
+ * Reads the entity config of the ray tracing viewer: the entity count, then one entity per line as
+ * op ax ay az bx by bz with a and b the opposite corners.
+ * op 0 is a colored box, 1 a mirror box and 2 a rectangle with the alpha blended mirror texture.
+ * Textures are only read into memory, no GL context is needed.
+ */
+std::vector<MeshModel> read_scene_config(const std::string &config_path, const std::string &texture_root);
+
+// the fixed models of the ray tracing viewer, textures are only read into memory
+std::vector<MeshModel> ray_tracing_demo_models(const std::string &texture_root);
+
+// grid by grid spheres on the plane z = -3 behind the demo models, filling x and y in [-2, 2],
+// sphere i * grid + j is the i-th along x and the j-th along y
+std::vector<MeshModel> sphere_grid_models(int grid);
@@ -5,18 +5,54 @@
 
 #include <format>
 #include <ostream>
+#include <limits>
+#include <algorithm>
 
 struct AxisAlignedBoundingBox {
     Interval x_range;
     Interval y_range;
     Interval z_range;
 
+    // empty box, expanding it by any point gives the box of that point
+    AxisAlignedBoundingBox() {
+        constexpr float inf = std::numeric_limits<float>::infinity();
+        x_range = Interval(inf, -inf);
+        y_range = Interval(inf, -inf);
+        z_range = Interval(inf, -inf);
+    }
+
     AxisAlignedBoundingBox(Point3d min_pt, Point3d max_pt) {
         x_range = Interval(min_pt.x, max_pt.x);
         y_range = Interval(min_pt.y, max_pt.y);
         z_range = Interval(min_pt.z, max_pt.z);
     }
 
+    void expand(const glm::vec3 &point);
+
+    void expand(const AxisAlignedBoundingBox &box);
+
+    float surface_area() const;
+
+    glm::vec3 center() const;
+
+    /*
+     * Slab test of the ray origin + t * dir given by its origin and the inverse of its direction.
+     * Returns the parameter interval [entry, exit] of the ray inside the box clipped to [t_min, t_max], empty when missed.
+     */
+    Interval ray_intersection(const glm::vec3 &origin, const glm::vec3 &inv_dir, float t_min, float t_max) const {
+        float tx1 = (x_range.start - origin.x) * inv_dir.x;
+        float tx2 = (x_range.end - origin.x) * inv_dir.x;
+        float ty1 = (y_range.start - origin.y) * inv_dir.y;
+        float ty2 = (y_range.end - origin.y) * inv_dir.y;
+        float tz1 = (z_range.start - origin.z) * inv_dir.z;
+        float tz2 = (z_range.end - origin.z) * inv_dir.z;
+
+        float entry = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::max(std::min(tz1, tz2), t_min));
+        float exit = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::min(std::max(tz1, tz2), t_max));
+
+        return Interval(entry, exit);
+    }
+
     static bool is_aabb_overlap(AxisAlignedBoundingBox box1, AxisAlignedBoundingBox box2);
 };
 
@@ -3,5 +3,7 @@
 struct Interval {
     float start, end;
 
+    bool is_empty() const { return start > end; }
+
     static float intersection_length(Interval int_a, Interval int_b);
 };
@@ -9,6 +9,7 @@
 #include "common/math/aabb.hxx"
 #include "shader.hxx"
 #include "common/camera/camera.hxx"
+#include "common/io/image_cache.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -24,9 +25,12 @@ struct Texture {
     unsigned int id;
     TextureType type;
     std::string path;
-    unsigned char* data;
+    const unsigned char* data;
     int num_channels;
     int width, height;
+
+    // the cached image data points into, null for data owned elsewhere
+    ImageHandle image;
 };
 
 struct TriangleVerticeIndex {
@@ -53,6 +57,9 @@ public:
 
     glm::vec3 object_color{1, 1, 1};
 
+    // the radiance of the model, the ray tracer samples every triangle of an emissive model as a light
+    glm::vec3 emission{0, 0, 0};
+
     unsigned int VBO{}, VAO{}, EBO{};
 
     std::vector<Texture> textures;
@@ -65,6 +72,9 @@ public:
 
     void bind_texture(const std::string& texture_path , TextureType type);
 
+    // read the texture into memory only, for use without a GL context
+    bool load_texture(const std::string& texture_path, TextureType type);
+
     void process_shadow_rendering(Shader& shader);
 
     void process_rendering(Shader& shader, Camera camera, unsigned int depth_map, glm::vec3 lightPos);
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <array>
+
+#include "common/ray_tracing/ray.h"
+#include "common/ray_tracing/ray_packet.h"
+#include "common/ray_tracing/triangle.h"
+#include "common/ray_tracing/ray_statistics.h"
+#include "common/math/aabb.hxx"
+#include "common/mesh_model.hxx"
+
+struct BVHNode {
+    AxisAlignedBoundingBox box;
+
+    // interior node: index of the right child, the left child is stored right after the node
+    // leaf node: index of the first primitive
+    unsigned int offset;
+
+    // number of primitives in a leaf, zero for interior nodes
+    unsigned int count;
+
+    bool is_leaf() const { return count > 0; }
+};
+
+struct BVHPrimitive {
+    unsigned int model_index;
+    unsigned int face_index;
+};
+
+/*
+ * Bounding volume hierarchy over the triangles of the given models, split by the binned surface area heuristic.
+ * The vertices are read as they are stored in the models, the model transforms are not applied.
+ */
+class BVH {
+public:
+    static constexpr int bin_count = 16;
+    static constexpr int max_leaf_size = 8;
+    static constexpr int max_depth = 64;
+
+    // a box to be placed in a hierarchy, primitive is its index in the list of the caller
+    struct BuildItem {
+        AxisAlignedBoundingBox box;
+        glm::vec3 centroid;
+        unsigned int primitive;
+    };
+
+    /*
+     * build the subtree over items[begin, end) and return the index of its root, the nodes are appended depth first
+     * and the items are reordered so that every leaf covers a contiguous range of them
+     */
+    static unsigned int build_node(std::vector<BVHNode> &nodes, std::vector<BuildItem> &items, unsigned int begin, unsigned int end, int depth);
+
+    /*
+     * recompute the boxes bottom up, keeping the tree as it is, leaf_box gives the box of a leaf node,
+     * a child is always stored after its parent so a single backward pass sees the children first
+     */
+    template<typename LeafBox>
+    static void refit_nodes(std::vector<BVHNode> &nodes, LeafBox &&leaf_box) {
+        for (auto n = nodes.size(); n-- > 0;) {
+            auto &node = nodes[n];
+            if (node.is_leaf()) {
+                node.box = leaf_box(node);
+            } else {
+                node.box = nodes[n + 1].box;
+                node.box.expand(nodes[node.offset].box);
+            }
+        }
+    }
+
+    /*
+     * expected number of box and triangle tests of a ray that enters the root, by the surface area heuristic,
+     * a refitted tree whose boxes have drifted apart costs more than the tree built for the same triangles
+     */
+    static float sah_cost(const std::vector<BVHNode> &nodes);
+
+    std::vector<BVHNode> nodes;
+    std::vector<BVHPrimitive> primitives;
+
+    // precomputed triangles in the same order as primitives
+    TriangleBuffer triangles;
+
+    void build(const std::vector<std::reference_wrapper<MeshModel>> &mesh_models);
+
+    // read the vertices of the same models again and refit the boxes, the faces must not have changed since build()
+    void refit(const std::vector<std::reference_wrapper<MeshModel>> &mesh_models);
+
+    // closest intersection with t in (t_min, t_max), t_max shrinks as hits are found
+    HitRecord closest_hit(const Ray &ray, float t_min, float t_max) const;
+
+    /*
+     * closest intersections of all the lanes of the packet, with t in (t_min, packet.t_max) per lane,
+     * a node is entered as soon as one lane hits its box so the packet should be coherent
+     */
+    void closest_hit(RayPacket &packet, float t_min, PacketHitRecord &record) const;
+
+    /*
+     * visit the intersections with t in (t_min, t_max) in no particular order,
+     * the visitor gets the index of the primitive in primitives and triangles, t and the barycentric weights,
+     * the traversal stops as soon as the visitor returns true and the result is true in that case
+     */
+    template<typename Visitor>
+    bool any_hit(const Ray &ray, float t_min, float t_max, Visitor &&visitor) const {
+        if (nodes.empty()) return false;
+
+        TraversalCounts counts;
+
+        std::array<unsigned int, max_depth> stack;
+        int stack_size = 0;
+        stack[stack_size++] = 0;
+
+        while (stack_size > 0) {
+            auto node_index = stack[--stack_size];
+            auto &node = nodes[node_index];
+
+            counts.box_tests++;
+            if (node.box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max).is_empty()) {
+                continue;
+            }
+            counts.nodes_visited++;
+
+            if (node.is_leaf()) {
+                counts.triangle_tests += node.count;
+                float t, u, v, w;
+                for (auto i = node.offset; i < node.offset + node.count; i++) {
+                    if (triangles.intersect(ray, i, t_min, t_max, t, u, v, w) and visitor(i, t, u, v, w)) {
+                        return true;
+                    }
+                }
+                continue;
+            }
+
+            stack[stack_size++] = node.offset;
+            stack[stack_size++] = node_index + 1;
+        }
+
+        return false;
+    }
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "common/ray_tracing/framebuffer.h"
+
+struct DenoiserSettings {
+    /*
+     * passes of the filter, pass k compares pixels 2^k apart: every pass smooths coarser noise, which fewer samples
+     * per pixel need, at the cost of time and of the finer shading details
+     */
+    int iterations {5};
+
+    // a neighbour this many standard errors of the mean away in luminance weighs 1 / e
+    float color_phi {4};
+
+    // the weight of a neighbour is the cosine between the normals to this power
+    float normal_phi {128};
+
+    // a neighbour whose depth differs by this many times the local change of depth over their distance weighs 1 / e
+    float depth_phi {1};
+
+    // zero uses every hardware thread
+    int thread_count {0};
+};
+
+/*
+ * Edge avoiding a-trous wavelet filter (Dammertz et al. 2010) with the variance guided luminance weight of the spatial
+ * part of SVGF (Schied et al. 2017). The color is divided by the first hit albedo before filtering and multiplied
+ * back after, so that only the lighting is smoothed and the textures stay sharp. Two pixels weigh less in the
+ * average of each other the more their normals, depths and luminances differ, the luminance being measured against
+ * the standard error of the mean of the pixel, which every pass reduces.
+ *
+ * Reads the color, the sample statistics and the auxiliary channels of the framebuffer, which must have them, and
+ * writes the channel "denoised", the color is left as it is. Returns the seconds it took.
+ */
+double denoise(FrameBuffer &framebuffer, const DenoiserSettings &settings = {});
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "common/io/image_cache.h"
+
+/*
+ * The sky seen by the rays that leave the scene: the six faces of the skybox read in place from the image cache,
+ * looked up like a GL cube map with linear filtering and clamped edges, so that it matches the skybox drawn by the
+ * viewers. An environment without faces is black.
+ */
+class EnvironmentMap {
+    std::array<ImageHandle, 6> faces;
+
+    glm::vec3 texel(const Image &image, int i, int j) const;
+
+public:
+    // the faces are scaled by it
+    float intensity {1};
+
+    EnvironmentMap() = default;
+
+    // right, left, top, bottom, front and back as for SkyBox::load_cube_map, empty unless all six are given
+    explicit EnvironmentMap(const std::vector<ImageHandle> &t_faces);
+
+    bool empty() const { return faces[0] == nullptr; }
+
+    // the radiance seen looking along direction, which needs not be normalized
+    glm::vec3 radiance(glm::vec3 direction) const;
+};
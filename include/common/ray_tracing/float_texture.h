@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "common/mesh_model.hxx"
+#include "common/ray_tracing/ray_statistics.h"
+
+// what a coordinate outside [0, 1] reads, repeat matches the GL_REPEAT of the rasterizer
+enum class TextureAddress {
+    repeat,
+    clamp
+};
+
+enum class TextureFilter {
+    nearest,
+    bilinear,
+    trilinear
+};
+
+// one level of the mip chain, the texels row by row from v = 0
+struct TextureLevel {
+    int width {0}, height {0};
+    std::vector<glm::vec4> texels;
+};
+
+/*
+ * A Texture converted once for the CPU ray tracer: RGBA floats in [0, 1], one aligned vec4 per texel, and the
+ * mip chain down to 1x1, every level the 2x2 box filter of the previous one. Textures without an alpha channel
+ * read an alpha of 1, grey ones read the grey value in r, g and b.
+ *
+ * The level of detail given to the trilinear filter is the log2 of the texel footprint of the lookup on level 0.
+ */
+class FloatTexture {
+    // most lookups fall inside the level and skip the division
+    int address_texel(int i, int size) const {
+        if (unsigned(i) < unsigned(size)) return i;
+        if (address == TextureAddress::clamp) return std::clamp(i, 0, size - 1);
+        i %= size;
+        return i < 0 ? i + size : i;
+    }
+
+    const glm::vec4 &texel(const TextureLevel &level, int i, int j) const {
+        return level.texels[size_t(address_texel(j, level.height)) * level.width + address_texel(i, level.width)];
+    }
+
+public:
+    std::vector<TextureLevel> levels;
+    TextureAddress address {TextureAddress::repeat};
+
+    FloatTexture() = default;
+
+    explicit FloatTexture(const Texture &texture, TextureAddress t_address = TextureAddress::repeat);
+
+    bool empty() const { return levels.empty(); }
+
+    int width() const { return levels.empty() ? 0 : levels[0].width; }
+
+    int height() const { return levels.empty() ? 0 : levels[0].height; }
+
+    // the level of detail of a lookup whose uv changes by duv_dx and duv_dy across the footprint of the ray
+    float lod(glm::vec2 duv_dx, glm::vec2 duv_dy) const {
+        glm::vec2 size {width(), height()};
+        float footprint = std::max(glm::length(duv_dx * size), glm::length(duv_dy * size));
+
+        // a footprint within one texel reads level 0, and so does the undefined one of a degenerate triangle
+        return footprint > 1 ? std::log2(footprint) : 0;
+    }
+
+    // the texel (i, j) of a level, the indices are addressed like the coordinates of a lookup
+    const glm::vec4 &texel(int level_index, int i, int j) const {
+        return texel(levels[level_index], i, j);
+    }
+
+    // the texel of level 0 the nearest lookup at uv reads, as in the old get_texture()
+    glm::vec4 nearest(glm::vec2 uv) const {
+        auto &level = levels[0];
+        return texel(level, int(std::floor(uv.x * level.width)), int(std::floor(uv.y * level.height)));
+    }
+
+    // the four texels around uv on a level weighted by their distance, the texel centres sit at (i + 0.5) / width
+    glm::vec4 bilinear(glm::vec2 uv, int level_index = 0) const {
+        auto &level = levels[level_index];
+        float x = uv.x * level.width - 0.5f;
+        float y = uv.y * level.height - 0.5f;
+        float x0 = std::floor(x), y0 = std::floor(y);
+        float fx = x - x0, fy = y - y0;
+        int i0 = address_texel(int(x0), level.width), i1 = address_texel(int(x0) + 1, level.width);
+        auto *row0 = &level.texels[size_t(address_texel(int(y0), level.height)) * level.width];
+        auto *row1 = &level.texels[size_t(address_texel(int(y0) + 1, level.height)) * level.width];
+
+        auto top = glm::mix(row0[i0], row0[i1], fx);
+        auto bottom = glm::mix(row1[i0], row1[i1], fx);
+        return glm::mix(top, bottom, fy);
+    }
+
+    // bilinear lookups on the two levels around lod blended by its fraction
+    glm::vec4 trilinear(glm::vec2 uv, float lod) const {
+        float max_lod = float(levels.size() - 1);
+        lod = std::clamp(lod, 0.0f, max_lod);
+
+        int lower = int(lod);
+        float fraction = lod - float(lower);
+        if (fraction == 0 or lower == int(max_lod)) return bilinear(uv, lower);
+
+        return glm::mix(bilinear(uv, lower), bilinear(uv, lower + 1), fraction);
+    }
+
+    glm::vec4 sample(glm::vec2 uv, TextureFilter filter, float lod = 0) const {
+        if (auto counters = thread_ray_counters) {
+            counters->texture_fetches++;
+        }
+
+        switch (filter) {
+            case TextureFilter::nearest:
+                return nearest(uv);
+            case TextureFilter::bilinear:
+                return bilinear(uv);
+            case TextureFilter::trilinear:
+                return trilinear(uv, lod);
+        }
+        return {};
+    }
+
+    /*
+     * count lookups at once with the filter chosen a single time, lod may be null for the filters that ignore it,
+     * meant for hits grouped by texture so that the texels of neighbouring lookups are still cached
+     */
+    void sample(const glm::vec2 *uv, const float *lod, size_t count, TextureFilter filter, glm::vec4 *result) const;
+};
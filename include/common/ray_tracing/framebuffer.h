@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// allocator returning storage aligned for wide vector loads
+template<typename T, size_t alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, alignment> &) {}
+
+    T *allocate(size_t count) {
+        return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(alignment)));
+    }
+
+    void deallocate(T *pointer, size_t) {
+        ::operator delete(pointer, std::align_val_t(alignment));
+    }
+
+    template<typename U>
+    bool operator == (const AlignedAllocator<U, alignment> &) const { return true; }
+};
+
+struct FrameBufferChannel {
+    std::string name;
+
+    // floats per pixel
+    int components;
+
+    // row major, the components of a pixel are stored together
+    std::vector<float, AlignedAllocator<float>> data;
+};
+
+// what the first hit of a sample shows, a ray leaving the scene gives black, no normal and depth zero
+struct AuxiliarySample {
+    glm::vec3 albedo {0, 0, 0};
+
+    // normalized, facing the camera
+    glm::vec3 normal {0, 0, 0};
+
+    // distance from the camera
+    float depth {0};
+};
+
+/*
+ * Image of runtime size with named float channels.
+ * The standard channels are "color" (running mean of the samples), "sample_count"
+ * and "variance" (sum of squared deviations of the sample luminance, see variance()).
+ * The auxiliary channels "albedo", "normal" and "depth" are only there once added, they hold
+ * the running means of the AuxiliarySample of every sample.
+ */
+class FrameBuffer {
+    std::vector<FrameBufferChannel> channels;
+
+    FrameBufferChannel *color_channel {nullptr};
+    FrameBufferChannel *count_channel {nullptr};
+    FrameBufferChannel *variance_channel {nullptr};
+
+    FrameBufferChannel *albedo_channel {nullptr};
+    FrameBufferChannel *normal_channel {nullptr};
+    FrameBufferChannel *depth_channel {nullptr};
+
+    void bind_standard_channels();
+
+public:
+    int width {0};
+    int height {0};
+
+    FrameBuffer(int t_width, int t_height);
+
+    FrameBuffer(const FrameBuffer &other);
+
+    FrameBuffer &operator = (const FrameBuffer &other);
+
+    // resizing keeps the channels and clears them
+    void resize(int t_width, int t_height);
+
+    // set every channel of every pixel to zero
+    void clear();
+
+    FrameBufferChannel &add_channel(const std::string &name, int components);
+
+    FrameBufferChannel *find_channel(const std::string &name);
+
+    const FrameBufferChannel *find_channel(const std::string &name) const;
+
+    const std::vector<FrameBufferChannel> &get_channels() const { return channels; }
+
+    size_t pixel_index(int x, int y) const { return size_t(y) * width + x; }
+
+    // the ray tracer fills them from then on
+    void add_auxiliary_channels();
+
+    bool has_auxiliary_channels() const { return albedo_channel != nullptr; }
+
+    // add one sample to the pixel at column x and row y, updating its mean, count and variance
+    void accumulate(int x, int y, const glm::vec3 &sample);
+
+    // add the first hit of the sample last given to accumulate() for the pixel, if there are auxiliary channels
+    void accumulate(int x, int y, const AuxiliarySample &sample);
+
+    // overwrite the pixel with the mean of count samples, the variance is reset
+    void set_color(int x, int y, const glm::vec3 &color, float count = 1);
+
+    glm::vec3 color(int x, int y) const;
+
+    float sample_count(int x, int y) const;
+
+    // unbiased variance of the sample luminance of the pixel
+    float variance(int x, int y) const;
+
+    float mean_luminance(int x, int y) const;
+
+    // standard error of the mean luminance of the pixel, infinite below two samples
+    float standard_error(int x, int y) const;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+// a shading point never traces more shadow rays than this
+constexpr const int MAX_LIGHT_SAMPLES = 8;
+
+enum class LightType {
+    // shines with the same color at any distance, as the light of the rasterizer
+    point,
+    // one triangle of an emissive model, both of its sides emit
+    triangle
+};
+
+// the light reaching a shading point from a point on a light
+struct LightSample {
+    glm::vec3 position;
+    glm::vec3 color;
+
+    // the density of the point over the solid angle seen from the shading point, zero for a point light
+    float pdf {0};
+};
+
+struct Light {
+    LightType type {LightType::point};
+
+    // the position of a point light, the first corner of a triangle, in world space
+    glm::vec3 position {0, 0, 0};
+
+    // the other two corners of a triangle relative to the first
+    glm::vec3 edge1 {0, 0, 0}, edge2 {0, 0, 0};
+
+    // the color of a point light, the radiance of a triangle
+    glm::vec3 color {1, 1, 1};
+
+    // the relative power the lights are picked by, a triangle counts its area and the hemispheres of both its sides
+    float power() const;
+
+    /*
+     * a point of the light seen from point, (u1, u2) uniform in the unit square pick it on a triangle,
+     * the color of a triangle is its radiance times the solid angle the triangle covers there
+     */
+    LightSample sample(glm::vec3 point, float u1, float u2) const;
+
+    // the density sample() gives to on_light, a point of a triangle, over the solid angle seen from point
+    float pdf(glm::vec3 point, glm::vec3 on_light) const;
+};
+
+// the single white point light of the ray tracer before the lights could be given, also the light of the viewers
+std::vector<Light> default_lights();
+
+/*
+ * Picks a light with a probability proportional to its power in constant time by the alias method of Vose.
+ * Every bin of the table holds the probability of keeping its own light and the light taken otherwise.
+ */
+class LightSampler {
+    std::vector<float> keep;
+    std::vector<unsigned int> alias;
+    std::vector<float> probabilities;
+
+public:
+    void build(const std::vector<Light> &lights);
+
+    bool empty() const { return keep.empty(); }
+
+    // the light picked by a uniform u in [0, 1)
+    unsigned int sample(float u) const;
+
+    // the probability the light i is picked with
+    float probability(unsigned int i) const { return probabilities[i]; }
+};
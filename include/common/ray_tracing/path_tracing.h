@@ -0,0 +1,34 @@
+#pragma once
+
+#include "common/ray_tracing/ray.h"
+#include "common/ray_tracing/ray_differential.h"
+#include "common/ray_tracing/scene.h"
+#include "common/ray_tracing/random.h"
+
+/*
+ * From min_bounces on, a path goes on with the probability of the largest component of its throughput, at most
+ * 0.95, and its throughput is divided by it (Russian roulette). max_bounces only stops the paths trapped between
+ * mirrors or inside a closed model.
+ */
+struct PathTracingSettings {
+    int min_bounces {3};
+    int max_bounces {64};
+};
+
+/*
+ * Unbiased radiance along a ray: the surfaces are Lambertian of their object color, the reflecting models are
+ * mirrors and a blended model lets 1 - alpha of the light through. Every diffuse hit samples one light picked by
+ * power and goes on along a cosine distributed direction, an emissive triangle reached both ways is weighted by the
+ * power heuristic. The ambient and Phong terms of the Whitted shading have no counterpart here.
+ *
+ * A point light gives the irradiance pi * color to a surface facing it at any distance, so that a white surface
+ * is as bright under it as with the Whitted shading.
+ *
+ * The random stream belongs to the first bounce, the streams of the following bounces are derived from it.
+ */
+glm::vec3 path_tracing_light(const Ray &ray, const Scene &scene, const RandomStream &random,
+                             const PathTracingSettings &settings = {}, const RayDifferential &differential = {});
+
+// the radiance of path_tracing_light for a ray whose closest hit is already known
+glm::vec3 path_tracing_shade(const Ray &ray, const HitRecord &record, const Scene &scene, const RandomStream &random,
+                             const PathTracingSettings &settings = {}, const RayDifferential &differential = {});
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "common/camera/camera.hxx"
+#include "common/mesh_model.hxx"
+#include "common/ray_tracing/scene.h"
+#include "common/ray_tracing/framebuffer.h"
+#include "common/ray_tracing/ray_tracing.h"
+
+/*
+ * Refines an image on background threads until it is stopped: every pass renders settings.samples_per_pixel
+ * samples of every pixel with its own seed and is merged into the estimate once complete, so the estimate
+ * always holds whole passes. Restarting abandons the pass in flight and starts from an empty estimate.
+ *
+ * The scene is built once in the constructor, the models must not change while the renderer lives.
+ */
+class ProgressiveRenderer {
+    Scene scene;
+    RayTracingSettings settings;
+
+    FrameBuffer estimate;
+    int pass_count {0};
+    mutable std::mutex estimate_mutex;
+
+    std::atomic<bool> cancel {false};
+
+    // set by the worker once it renders no more passes, after max_passes or when cancelled
+    std::atomic<bool> finished {true};
+    std::thread worker;
+
+    void run(Camera camera);
+
+public:
+    // zero keeps refining until stopped
+    int max_passes {0};
+
+    // builds the scene lit by the lights, the models are only read
+    ProgressiveRenderer(const std::vector<std::reference_wrapper<MeshModel>> &mesh_models, int width, int height,
+                        const RayTracingSettings &t_settings = {}, const std::vector<Light> &lights = default_lights());
+
+    // renders a scene already built, its models are only read
+    ProgressiveRenderer(Scene t_scene, int width, int height, const RayTracingSettings &t_settings = {});
+
+    ~ProgressiveRenderer();
+
+    ProgressiveRenderer(const ProgressiveRenderer &) = delete;
+    ProgressiveRenderer &operator = (const ProgressiveRenderer &) = delete;
+
+    // cancel the render in flight, if any, and start over from the camera
+    void restart(const Camera &camera);
+
+    // cancel the render in flight and wait for its threads, the estimate is kept
+    void stop();
+
+    // a pass is in flight or more will follow, false once max_passes are merged or the render is stopped
+    bool running() const { return not finished; }
+
+    int width() const { return estimate.width; }
+
+    int height() const { return estimate.height; }
+
+    // number of passes merged into the estimate so far
+    int passes() const;
+
+    // copy the mean colour of every pixel, row by row from the top, and return the number of passes it holds
+    int copy_estimate(std::vector<glm::vec3> &colors) const;
+};
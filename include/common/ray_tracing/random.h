@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Counter based random numbers: the i-th number of a stream is a hash of the stream key and i,
+ * the key is built from (seed, pixel, sample, bounce).
+ * The result does not depend on the thread that renders a pixel or on the tile order, and nothing is allocated.
+ */
+class RandomStream {
+    uint64_t key;
+    uint32_t counter {0};
+
+    // SplitMix64 finalizer, a bijective mix with full avalanche
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    explicit RandomStream(uint64_t t_key): key(t_key) {}
+
+public:
+    // the stream of key zero, meant to be overwritten
+    RandomStream(): key(0) {}
+
+    RandomStream(uint32_t pixel, uint32_t sample, uint32_t seed = 0)
+        : key(mix(mix((uint64_t(seed) << 32) | pixel) ^ (uint64_t(sample) + 0x9e3779b97f4a7c15ull))) {}
+
+    // an independent stream for the given bounce of the same path
+    RandomStream bounce(uint32_t depth) const {
+        return RandomStream(mix(key ^ (uint64_t(depth) << 32 | 0x2545f491u)));
+    }
+
+    uint32_t next_uint() {
+        return uint32_t(mix(key + 0x9e3779b97f4a7c15ull * ++counter) >> 32);
+    }
+
+    // uniform in [0, 1)
+    float next_float() {
+        return float(next_uint() >> 8) * 0x1.0p-24f;
+    }
+};
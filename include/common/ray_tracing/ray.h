@@ -2,15 +2,34 @@
 
 #include "glm/glm.hpp"
 
+#include <tuple>
+
 class Ray {
     public:
         glm::vec3 base;
         glm::vec3 dir;
 
+        // component-wise inverse of dir, used by the slab tests against bounding boxes
+        glm::vec3 inv_dir;
+
         Ray() {}
-        Ray(const glm::vec3 &t_base, const glm::vec3 &t_dir): base(t_base), dir(t_dir) {}
+        Ray(const glm::vec3 &t_base, const glm::vec3 &t_dir): base(t_base), dir(t_dir), inv_dir(1.0f / t_dir) {}
 
         glm::vec3 at(float t) const;
 
         std::tuple<bool, float, float, float, float> ray_triangle_intersection(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2) const;
+};
+
+// closest intersection found along a ray
+struct HitRecord {
+    bool hit {false};
+
+    // ray parameter of the hit point
+    float t {0};
+
+    // barycentric weights of the three vertices of the triangle
+    float u {0}, v {0}, w {0};
+
+    unsigned int model_index {0};
+    unsigned int face_index {0};
 };
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+/*
+ * Ray differentials after Igehy: how the origin p and the direction d of a ray change from one pixel to the next
+ * horizontally (x) and vertically (y). They follow the ray through every hit, so that the footprint of the ray
+ * on a surface picks the mip level of the textures read there. Zero differentials describe a footprint of a point.
+ *
+ * The directions need not be normalized, the formulas hold for the ray p + t * d as traced.
+ */
+struct RayDifferential {
+    glm::vec3 dp_dx {0}, dp_dy {0};
+    glm::vec3 dd_dx {0}, dd_dy {0};
+
+    // the differentials at the hit p + t * d of the plane with the given normal, the direction ones are kept
+    RayDifferential transfer(const glm::vec3 &dir, float t, const glm::vec3 &plane_normal) const {
+        float d_dot_n = glm::dot(dir, plane_normal);
+        if (d_dot_n == 0) return *this;
+
+        auto transfer_one = [&](const glm::vec3 &dp, const glm::vec3 &dd) {
+            auto moved = dp + t * dd;
+            return moved - glm::dot(moved, plane_normal) / d_dot_n * dir;
+        };
+
+        RayDifferential result = *this;
+        result.dp_dx = transfer_one(dp_dx, dd_dx);
+        result.dp_dy = transfer_one(dp_dy, dd_dy);
+        return result;
+    }
+
+    /*
+     * the differentials of the reflection d - 2 (d . n) n leaving the hit, with the differentials of the shading
+     * normal n across the footprint, the origin ones are kept
+     */
+    RayDifferential reflect(const glm::vec3 &dir, const glm::vec3 &normal, const glm::vec3 &dn_dx, const glm::vec3 &dn_dy) const {
+        float d_dot_n = glm::dot(dir, normal);
+
+        auto reflect_one = [&](const glm::vec3 &dd, const glm::vec3 &dn) {
+            float d_dot_n_derivative = glm::dot(dd, normal) + glm::dot(dir, dn);
+            return dd - 2.0f * (d_dot_n_derivative * normal + d_dot_n * dn);
+        };
+
+        RayDifferential result = *this;
+        result.dd_dx = reflect_one(dd_dx, dn_dx);
+        result.dd_dy = reflect_one(dd_dy, dn_dy);
+        return result;
+    }
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+
+#include "glm/glm.hpp"
+#include "common/ray_tracing/ray.h"
+#include "common/math/aabb.hxx"
+
+// 8 lanes fill an AVX register, SSE splits every lane loop in two halves
+constexpr int RAY_PACKET_SIZE = 8;
+
+/*
+ * Coherent rays traced together, stored lane by lane so that the loops over the lanes vectorize.
+ * A lane takes part in the traversal while t_min < t_max, an unused lane has t_max set to -inf
+ * and never passes a box or triangle test, the per-lane test results act as the masks.
+ */
+struct RayPacket {
+    alignas(32) float base_x[RAY_PACKET_SIZE];
+    alignas(32) float base_y[RAY_PACKET_SIZE];
+    alignas(32) float base_z[RAY_PACKET_SIZE];
+
+    alignas(32) float dir_x[RAY_PACKET_SIZE];
+    alignas(32) float dir_y[RAY_PACKET_SIZE];
+    alignas(32) float dir_z[RAY_PACKET_SIZE];
+
+    alignas(32) float inv_dir_x[RAY_PACKET_SIZE];
+    alignas(32) float inv_dir_y[RAY_PACKET_SIZE];
+    alignas(32) float inv_dir_z[RAY_PACKET_SIZE];
+
+    // upper end of the search interval of every lane, shrinks as hits are found
+    alignas(32) float t_max[RAY_PACKET_SIZE];
+
+    RayPacket() {
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            set_inactive(lane);
+        }
+    }
+
+    void set(int lane, const Ray &ray, float lane_t_max) {
+        base_x[lane] = ray.base.x;
+        base_y[lane] = ray.base.y;
+        base_z[lane] = ray.base.z;
+        dir_x[lane] = ray.dir.x;
+        dir_y[lane] = ray.dir.y;
+        dir_z[lane] = ray.dir.z;
+        inv_dir_x[lane] = ray.inv_dir.x;
+        inv_dir_y[lane] = ray.inv_dir.y;
+        inv_dir_z[lane] = ray.inv_dir.z;
+        t_max[lane] = lane_t_max;
+    }
+
+    // a finite dummy ray so that the arithmetic of the lane stays quiet
+    void set_inactive(int lane) {
+        set(lane, Ray({0, 0, 0}, {1, 1, 1}), -std::numeric_limits<float>::infinity());
+    }
+
+    // the slab test for every lane, returns the nearest entry among the lanes that hit the box or infinity if none does
+    float entry(const AxisAlignedBoundingBox &box, float t_min) const {
+        constexpr float inf = std::numeric_limits<float>::infinity();
+        float nearest = inf;
+
+        #pragma omp simd reduction(min: nearest)
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            float tx1 = (box.x_range.start - base_x[lane]) * inv_dir_x[lane];
+            float tx2 = (box.x_range.end - base_x[lane]) * inv_dir_x[lane];
+            float ty1 = (box.y_range.start - base_y[lane]) * inv_dir_y[lane];
+            float ty2 = (box.y_range.end - base_y[lane]) * inv_dir_y[lane];
+            float tz1 = (box.z_range.start - base_z[lane]) * inv_dir_z[lane];
+            float tz2 = (box.z_range.end - base_z[lane]) * inv_dir_z[lane];
+
+            float slab_entry = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::max(std::min(tz1, tz2), t_min));
+            float slab_exit = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::min(std::max(tz1, tz2), t_max[lane]));
+
+            nearest = std::min(nearest, slab_entry <= slab_exit ? slab_entry : inf);
+        }
+
+        return nearest;
+    }
+
+    float farthest_t_max() const {
+        float farthest = -std::numeric_limits<float>::infinity();
+
+        #pragma omp simd reduction(max: farthest)
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            farthest = std::max(farthest, t_max[lane]);
+        }
+
+        return farthest;
+    }
+};
+
+// closest hits of the lanes of a packet, primitive is the index in BVH::primitives
+struct PacketHitRecord {
+    alignas(32) int hit[RAY_PACKET_SIZE] {};
+    alignas(32) float t[RAY_PACKET_SIZE] {};
+    alignas(32) float u[RAY_PACKET_SIZE] {};
+    alignas(32) float v[RAY_PACKET_SIZE] {};
+    alignas(32) float w[RAY_PACKET_SIZE] {};
+    alignas(32) unsigned int primitive[RAY_PACKET_SIZE] {};
+};
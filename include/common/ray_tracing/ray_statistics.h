@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "common/ray_tracing/framebuffer.h"
+#include "common/ray_tracing/tile_scheduler.h"
+
+// what the ray tracer did on one thread, aligned so that the counters of two threads never share a cache line
+struct alignas(64) RayCounters {
+    uint64_t primary_rays {0};
+    uint64_t shadow_rays {0};
+
+    // the continuation rays of the Whitted shading and the bounces of the path tracer
+    uint64_t secondary_rays {0};
+
+    // a wide node counts a test for each of its children, a packet one for each of its lanes
+    uint64_t box_tests {0};
+
+    // a block of triangles counts all its slots, a packet all its lanes
+    uint64_t triangle_tests {0};
+
+    // nodes of the top and bottom level hierarchies whose children or triangles were tested
+    uint64_t nodes_visited {0};
+
+    // filtered texture lookups, whatever the number of texels they read
+    uint64_t texture_fetches {0};
+
+    uint64_t rays() const { return primary_rays + shadow_rays + secondary_rays; }
+
+    RayCounters &operator += (const RayCounters &other);
+};
+
+// the counters of the calling thread while it renders a tile with statistics, null otherwise
+inline thread_local RayCounters *thread_ray_counters = nullptr;
+
+// counts of one traversal kept in registers, added to the counters of the thread when it ends
+struct TraversalCounts {
+    uint64_t box_tests {0};
+    uint64_t triangle_tests {0};
+    uint64_t nodes_visited {0};
+
+    TraversalCounts() = default;
+    TraversalCounts(const TraversalCounts &) = delete;
+    TraversalCounts &operator = (const TraversalCounts &) = delete;
+
+    ~TraversalCounts() {
+        if (auto counters = thread_ray_counters) {
+            counters->box_tests += box_tests;
+            counters->triangle_tests += triangle_tests;
+            counters->nodes_visited += nodes_visited;
+        }
+    }
+};
+
+struct TileTiming {
+    Tile tile;
+    int thread_index;
+
+    // wall time of the tile, of all its rounds with adaptive sampling
+    double seconds;
+};
+
+/*
+ * Filled by a render given it in RayTracingSettings::statistics. Every thread counts into its own counters, which are
+ * only added up once the render is over, so the threads never contend for them while tracing. The time spent on
+ * every pixel is summed into the channel "cost" of the framebuffer: the primary rays of a packet share its time
+ * and the wavefront integrator, which interleaves the pixels of a tile, shares the time of the tile among them.
+ */
+struct RenderStatistics {
+    int width {0};
+    int height {0};
+    int thread_count {0};
+    int samples_per_pixel {0};
+
+    // wall time of the whole render
+    double seconds {0};
+
+    // sum of the counters of all the threads
+    RayCounters counters;
+
+    std::vector<RayCounters> thread_counters;
+    std::vector<TileTiming> tiles;
+
+    // millions of rays of any kind per second of wall time
+    double mrays_per_second() const;
+
+    // forget a previous render and prepare the counters of thread_count threads
+    void reset(int t_width, int t_height, int t_thread_count, int t_samples_per_pixel);
+
+    // adds up the thread counters and merges the timings of a tile rendered in several rounds
+    void merge();
+
+    // the summary as one JSON object, with the counters of every thread and the timing of every tile
+    void write_json(std::ostream &stream) const;
+};
+
+/*
+ * the channel "cost" of the framebuffer as a false colour image in the channel "color" of the result, from black
+ * through blue, red and yellow to white at the 99th percentile of the cost and above
+ */
+FrameBuffer cost_heatmap(const FrameBuffer &framebuffer);
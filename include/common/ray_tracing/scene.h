@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <functional>
+
+#include "common/ray_tracing/ray.h"
+#include "common/ray_tracing/ray_packet.h"
+#include "common/ray_tracing/bvh.h"
+#include "common/ray_tracing/wide_bvh.h"
+#include "common/ray_tracing/float_texture.h"
+#include "common/ray_tracing/light.h"
+#include "common/ray_tracing/environment.h"
+#include "common/mesh_model.hxx"
+
+// how a triangle blocks the light, decided once from the alpha values inside its uv footprint
+enum class TriangleOpacity : unsigned char {
+    opaque,
+    transparent,
+    alpha_test
+};
+
+// acceleration structure of one distinct mesh in object space, shared by all the models that use the mesh
+struct SceneMesh {
+    // binary hierarchy for ray packets, the wide one collapsed from it serves the single rays
+    BVH bvh;
+    WideBVH wide_bvh;
+
+    // opacity of every triangle in the order of bvh.primitives
+    std::vector<TriangleOpacity> opacity;
+
+    // BVH::sah_cost of bvh when it was last built, the refits are measured against it
+    float built_cost;
+
+    // the first model of the scene that uses the mesh, its vertices and textures were read to build it
+    unsigned int source_model;
+};
+
+// a model placed in the scene: the mesh it uses and the transform of the model at build time
+struct SceneInstance {
+    unsigned int mesh {0};
+
+    glm::mat4 object_to_world {1.0f};
+    glm::mat4 world_to_object {1.0f};
+
+    // inverse transpose of the linear part of object_to_world
+    glm::mat3 normal_to_world {1.0f};
+
+    AxisAlignedBoundingBox world_box;
+
+    // the rays are not transformed for an identity transform
+    bool identity {true};
+
+    // index in Scene::textures of every texture of the model, in the order of MeshModel::textures
+    std::vector<unsigned int> textures;
+};
+
+/*
+ * The models seen by the ray tracer together with a two level acceleration structure: one hierarchy per distinct
+ * mesh over its vertices as stored, and a top hierarchy over the world boxes of the models. A ray is transformed
+ * into the object space of every model it reaches without normalizing its direction, so the t of a hit is the same
+ * in both spaces. Models with equal vertices, faces and blending texture share one mesh whatever their transforms.
+ *
+ * The models are referenced, not copied, and only read, build() must be called again after they change.
+ * The hit records name the model by its index in mesh_models.
+ */
+class Scene {
+    std::vector<BVHNode> top_nodes;
+
+    // the instances in the order of the leaves of top_nodes
+    std::vector<unsigned int> instance_order;
+
+    float top_built_cost {0};
+
+    void build_meshes();
+
+    void build_mesh(SceneMesh &mesh);
+
+    void build_top_level();
+
+    void build_textures();
+
+    // index in lights of the first triangle of every emissive model
+    std::vector<unsigned int> first_lights;
+
+    // the point lights and a triangle light for every triangle of the emissive models at their current transforms
+    void build_lights();
+
+    // read the transform of the k-th model again
+    void place_instance(unsigned int k);
+
+    void classify_opacity(SceneMesh &mesh);
+
+    Ray to_object(const SceneInstance &instance, const Ray &ray) const;
+
+public:
+    std::vector<std::reference_wrapper<MeshModel>> mesh_models;
+
+    std::vector<SceneMesh> meshes;
+
+    // one instance per model, in the order of mesh_models
+    std::vector<SceneInstance> instances;
+
+    // the textures of the models converted once, models holding the same image share it
+    std::vector<FloatTexture> textures;
+
+    /*
+     * the filter of every texture lookup of the shading and of the shadow rays, the shading picks the mip level
+     * from the ray differentials, the shadow rays carry none and read level 0
+     */
+    TextureFilter texture_filter {TextureFilter::trilinear};
+
+    // the lights given to the scene, build() adds the emissive models to them in lights
+    std::vector<Light> point_lights;
+
+    std::vector<Light> lights;
+    LightSampler light_sampler;
+
+    /*
+     * the shadow rays of a shading point, up to MAX_LIGHT_SAMPLES: with no more lights than that every light gets one,
+     * otherwise as many lights are picked by their power
+     */
+    int light_samples {4};
+
+    // the radiance of the rays leaving the scene, black unless faces are given
+    EnvironmentMap environment;
+
+    Scene() = default;
+
+    explicit Scene(const std::vector<std::reference_wrapper<MeshModel>> &t_mesh_models,
+                   const std::vector<Light> &t_point_lights = default_lights());
+
+    // a refitted hierarchy is built again once its surface area cost exceeds its cost at build time by this factor
+    float rebuild_cost_ratio {1.5f};
+
+    void build();
+
+    /*
+     * update the scene after the models moved, without the cost of build(): the transforms of all the models are read
+     * again and the top hierarchy is refitted, the meshes of the models listed in deformed_models are refitted from
+     * their current vertices. The faces of the models must be the same as at build time. A hierarchy degraded beyond
+     * rebuild_cost_ratio is built again, and so is the whole scene when a deformed model shares its mesh.
+     * Returns whether anything was built again.
+     */
+    bool refit(const std::vector<unsigned int> &deformed_models = {});
+
+    // closest hit with t in (t_min, t_max), no allocation is made along the way
+    HitRecord intersect(const Ray &ray, float t_min, float t_max) const;
+
+    // closest hits of the lanes of a coherent packet with t in (t_min, packet.t_max), inactive lanes report no hit
+    void intersect(RayPacket &packet, float t_min, std::array<HitRecord, RAY_PACKET_SIZE> &records) const;
+
+    /*
+     * occlusion along a shadow ray with t in (t_min, t_max): 1 when an opaque triangle is hit,
+     * otherwise the largest alpha of the blended triangles hit, the traversal stops as soon as the result reaches 1
+     */
+    float occlusion(const Ray &ray, float t_min, float t_max) const;
+
+    MeshModel &model(const HitRecord &record) const;
+
+    const SceneInstance &instance(const HitRecord &record) const;
+
+    const TriangleVerticeIndex &triangle(const HitRecord &record) const;
+
+    // the index in lights of the triangle hit on an emissive model
+    unsigned int light_index(const HitRecord &record) const;
+
+    // the k-th texture of the model hit
+    const FloatTexture &texture(const HitRecord &record, size_t k) const;
+
+    // world space bounds of all the models
+    AxisAlignedBoundingBox bounds() const;
+
+    // number of triangles of all the models, the shared meshes counted once per model
+    size_t triangle_count() const;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "common/mesh_model.hxx"
+
+struct RGB {
+    unsigned char r, g, b;
+};
+
+struct RGBA {
+    unsigned char r, g, b, a;
+};
+
+glm::vec3 get_texture_rgb(const Texture &texture, float u, float v);
+
+glm::vec4 get_texture_rgba(const Texture &texture, float u, float v);
+
+glm::vec3 get_texture(const Texture &texture, float u, float v);
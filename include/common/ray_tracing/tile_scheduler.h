@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+// a rectangle of pixels [x_begin, x_end) x [y_begin, y_end), x is the column and y the row
+struct Tile {
+    int x_begin, y_begin;
+    int x_end, y_end;
+};
+
+enum class TileOrder {
+    // row by row from the top left corner
+    scanline,
+    // square rings around the image centre, the centre is rendered first
+    spiral
+};
+
+/*
+ * Splits an image into fixed size tiles and renders them on a pool of threads.
+ * Every thread owns a queue of tiles and takes from its front, an idle thread steals from the back of another queue.
+ */
+class TileScheduler {
+    std::vector<Tile> tiles;
+
+public:
+    TileScheduler(int width, int height, int tile_size = 32, TileOrder order = TileOrder::spiral);
+
+    const std::vector<Tile> &get_tiles() const { return tiles; }
+
+    // zero stands for the hardware concurrency
+    static int resolve_thread_count(int thread_count);
+
+    /*
+     * render_tile(tile, thread_index) is called once for every tile,
+     * progress(finished_tiles, total_tiles) after every finished tile, the calls to progress never overlap
+     */
+    void run(int thread_count, const std::function<void(const Tile &, int)> &render_tile,
+             const std::function<void(int, int)> &progress = {}) const;
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include "glm/glm.hpp"
+#include "common/ray_tracing/ray.h"
+#include "common/ray_tracing/ray_packet.h"
+
+/*
+ * Triangles prepared for ray intersection, stored as structure of arrays.
+ * Each triangle keeps its first vertex and the two edges leaving it, which is all the Möller–Trumbore test reads.
+ */
+class TriangleBuffer {
+public:
+    std::vector<float> v0_x, v0_y, v0_z;
+    std::vector<float> e1_x, e1_y, e1_z;
+    std::vector<float> e2_x, e2_y, e2_z;
+
+    size_t size() const { return v0_x.size(); }
+
+    void clear();
+
+    void reserve(size_t count);
+
+    void push_back(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2);
+
+    void set(size_t i, const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2);
+
+    glm::vec3 vertex(size_t i, int k) const;
+
+    /*
+     * Möller–Trumbore intersection with the i-th triangle, no square root involved.
+     * All conditions are evaluated together at the end, which keeps the test free of unpredictable early exits.
+     * On a hit in (t_min, t_max) it writes the ray parameter and the barycentric weights u v w of the three vertices.
+     */
+    bool intersect(const Ray &ray, size_t i, float t_min, float t_max, float &t, float &u, float &v, float &w) const {
+        constexpr float eps = 1e-12;
+
+        float e1x = e1_x[i], e1y = e1_y[i], e1z = e1_z[i];
+        float e2x = e2_x[i], e2y = e2_y[i], e2z = e2_z[i];
+
+        float px = ray.dir.y * e2z - ray.dir.z * e2y;
+        float py = ray.dir.z * e2x - ray.dir.x * e2z;
+        float pz = ray.dir.x * e2y - ray.dir.y * e2x;
+        float det = e1x * px + e1y * py + e1z * pz;
+        float inv_det = 1.0f / det;
+
+        float sx = ray.base.x - v0_x[i];
+        float sy = ray.base.y - v0_y[i];
+        float sz = ray.base.z - v0_z[i];
+        float b1 = (sx * px + sy * py + sz * pz) * inv_det;
+
+        float qx = sy * e1z - sz * e1y;
+        float qy = sz * e1x - sx * e1z;
+        float qz = sx * e1y - sy * e1x;
+        float b2 = (ray.dir.x * qx + ray.dir.y * qy + ray.dir.z * qz) * inv_det;
+
+        float hit_t = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+
+        bool hit = (std::fabs(det) > eps) & (b1 >= 0) & (b2 >= 0) & (b1 + b2 <= 1) & (hit_t > t_min) & (hit_t < t_max);
+        if (not hit) return false;
+
+        t = hit_t;
+        u = 1 - b1 - b2;
+        v = b1;
+        w = b2;
+        return true;
+    }
+
+    /*
+     * The same test for every lane of the packet against the i-th triangle, the lanes are processed as one vector.
+     * A hit closer than the t_max of its lane replaces the lane in record and becomes its new t_max.
+     */
+    void intersect(RayPacket &packet, unsigned int i, float t_min, PacketHitRecord &record) const {
+        constexpr float eps = 1e-12;
+
+        const float v0x = v0_x[i], v0y = v0_y[i], v0z = v0_z[i];
+        const float e1x = e1_x[i], e1y = e1_y[i], e1z = e1_z[i];
+        const float e2x = e2_x[i], e2y = e2_y[i], e2z = e2_z[i];
+
+        #pragma omp simd
+        for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+            float dx = packet.dir_x[lane], dy = packet.dir_y[lane], dz = packet.dir_z[lane];
+
+            float px = dy * e2z - dz * e2y;
+            float py = dz * e2x - dx * e2z;
+            float pz = dx * e2y - dy * e2x;
+            float det = e1x * px + e1y * py + e1z * pz;
+            float inv_det = 1.0f / det;
+
+            float sx = packet.base_x[lane] - v0x;
+            float sy = packet.base_y[lane] - v0y;
+            float sz = packet.base_z[lane] - v0z;
+            float b1 = (sx * px + sy * py + sz * pz) * inv_det;
+
+            float qx = sy * e1z - sz * e1y;
+            float qy = sz * e1x - sx * e1z;
+            float qz = sx * e1y - sy * e1x;
+            float b2 = (dx * qx + dy * qy + dz * qz) * inv_det;
+
+            float hit_t = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+
+            bool hit = (std::fabs(det) > eps) & (b1 >= 0) & (b2 >= 0) & (b1 + b2 <= 1) & (hit_t > t_min) & (hit_t < packet.t_max[lane]);
+
+            packet.t_max[lane] = hit ? hit_t : packet.t_max[lane];
+            record.hit[lane] = hit ? 1 : record.hit[lane];
+            record.t[lane] = hit ? hit_t : record.t[lane];
+            record.u[lane] = hit ? 1 - b1 - b2 : record.u[lane];
+            record.v[lane] = hit ? b1 : record.v[lane];
+            record.w[lane] = hit ? b2 : record.w[lane];
+            record.primitive[lane] = hit ? i : record.primitive[lane];
+        }
+    }
+};
+
+constexpr int TRIANGLE_BLOCK_SIZE = 8;
+
+/*
+ * Up to TRIANGLE_BLOCK_SIZE triangles of a leaf stored as structure of arrays, tested against one ray at once.
+ * Unused slots hold a degenerate triangle that no ray hits.
+ */
+struct TriangleBlock {
+    alignas(32) float v0_x[TRIANGLE_BLOCK_SIZE], v0_y[TRIANGLE_BLOCK_SIZE], v0_z[TRIANGLE_BLOCK_SIZE];
+    alignas(32) float e1_x[TRIANGLE_BLOCK_SIZE], e1_y[TRIANGLE_BLOCK_SIZE], e1_z[TRIANGLE_BLOCK_SIZE];
+    alignas(32) float e2_x[TRIANGLE_BLOCK_SIZE], e2_y[TRIANGLE_BLOCK_SIZE], e2_z[TRIANGLE_BLOCK_SIZE];
+
+    // index of every slot in BVH::primitives
+    unsigned int primitive[TRIANGLE_BLOCK_SIZE];
+
+    TriangleBlock();
+
+    // copy the i-th triangle of the buffer into a slot
+    void set(int slot, const TriangleBuffer &triangles, unsigned int i);
+
+    /*
+     * Möller–Trumbore test of the ray against every slot, the hits with t in (t_min, t_max) are flagged in hit
+     * together with their t and barycentric weights, the result is the number of hits.
+     */
+    int intersect(const Ray &ray, float t_min, float t_max, int *hit, float *t, float *u, float *v, float *w) const {
+        constexpr float eps = 1e-12;
+
+        const float dx = ray.dir.x, dy = ray.dir.y, dz = ray.dir.z;
+        const float ox = ray.base.x, oy = ray.base.y, oz = ray.base.z;
+        int hit_count = 0;
+
+        #pragma omp simd reduction(+: hit_count)
+        for (int slot = 0; slot < TRIANGLE_BLOCK_SIZE; slot++) {
+            float px = dy * e2_z[slot] - dz * e2_y[slot];
+            float py = dz * e2_x[slot] - dx * e2_z[slot];
+            float pz = dx * e2_y[slot] - dy * e2_x[slot];
+            float det = e1_x[slot] * px + e1_y[slot] * py + e1_z[slot] * pz;
+            float inv_det = 1.0f / det;
+
+            float sx = ox - v0_x[slot];
+            float sy = oy - v0_y[slot];
+            float sz = oz - v0_z[slot];
+            float b1 = (sx * px + sy * py + sz * pz) * inv_det;
+
+            float qx = sy * e1_z[slot] - sz * e1_y[slot];
+            float qy = sz * e1_x[slot] - sx * e1_z[slot];
+            float qz = sx * e1_y[slot] - sy * e1_x[slot];
+            float b2 = (dx * qx + dy * qy + dz * qz) * inv_det;
+
+            float hit_t = (e2_x[slot] * qx + e2_y[slot] * qy + e2_z[slot] * qz) * inv_det;
+
+            bool slot_hit = (std::fabs(det) > eps) & (b1 >= 0) & (b2 >= 0) & (b1 + b2 <= 1) & (hit_t > t_min) & (hit_t < t_max);
+
+            hit[slot] = slot_hit;
+            t[slot] = slot_hit ? hit_t : std::numeric_limits<float>::infinity();
+            u[slot] = 1 - b1 - b2;
+            v[slot] = b1;
+            w[slot] = b2;
+            hit_count += slot_hit;
+        }
+
+        return hit_count;
+    }
+};
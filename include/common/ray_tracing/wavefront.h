@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "common/ray_tracing/ray.h"
+#include "common/ray_tracing/scene.h"
+#include "common/ray_tracing/random.h"
+#include "common/ray_tracing/ray_differential.h"
+#include "common/ray_tracing/framebuffer.h"
+#include "common/ray_tracing/tile_scheduler.h"
+
+/*
+ * Breadth first evaluation of ray_tracing_light for all the samples of a tile. Every shaded hit continues its path
+ * with exactly one refracted or reflected ray, so a path is a chain and its radiance is the sum of the local terms
+ * weighted by the product of the continuation weights before them.
+ *
+ * One bounce of the tile is processed at a time: the rays are sorted by direction octant and by the Morton code
+ * of their origin and traced in that order, the hits are shaded grouped by model, which owns the textures,
+ * and the shadow rays of the bounce are traced together afterwards.
+ *
+ * An integrator keeps its buffers between tiles, every render thread needs its own.
+ */
+class WavefrontIntegrator {
+    // a ray of a path waiting for its next bounce
+    struct PathRay {
+        Ray ray;
+        // product of the continuation weights along the path so far
+        float throughput;
+        glm::vec3 light_color;
+        int depth;
+        RayDifferential differential;
+        RandomStream random;
+        // index of the sample within the tile
+        unsigned int sample;
+    };
+
+    // a light term of a hit, scaled by the throughput of its path, waiting for the shadow test
+    struct ShadowRay {
+        glm::vec3 position;
+        glm::vec3 light_position;
+        glm::vec3 shadowed;
+        unsigned int sample;
+    };
+
+    const Scene &scene;
+
+    // bounds of the scene, the origins are quantized inside them for the sort keys
+    AxisAlignedBoundingBox bounds;
+
+    std::vector<PathRay> paths, next_paths;
+    std::vector<HitRecord> records;
+    std::vector<ShadowRay> shadow_rays;
+
+    // sort key in the upper 32 bits and the index of the ray in the lower ones
+    std::vector<uint64_t> keys;
+
+    std::vector<glm::vec3> radiance;
+
+    // the first hits of the samples, only kept for a framebuffer with auxiliary channels
+    std::vector<AuxiliarySample> auxiliary;
+
+    uint32_t sort_key(const Ray &ray) const;
+
+    void sort_paths();
+
+    void trace_paths();
+
+    void shade_hits();
+
+    void trace_shadow_rays();
+
+public:
+    // the jittered primary ray of sample k of pixel (i, j), its differentials and the random stream of its first bounce
+    using PrimaryRay = std::function<std::tuple<Ray, RayDifferential, RandomStream>(int, int, int)>;
+
+    explicit WavefrontIntegrator(const Scene &t_scene);
+
+    /*
+     * accumulates samples_per_pixel more samples into every pixel of the tile, in the order of the samples,
+     * the sample indices go on from the sample count of the pixel, only the pixels set in active are sampled
+     * when it is given
+     */
+    void render_tile(const Tile &tile, int samples_per_pixel, const PrimaryRay &primary_ray, FrameBuffer &framebuffer,
+                     const std::vector<unsigned char> *active = nullptr);
+};
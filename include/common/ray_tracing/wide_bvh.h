@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <vector>
+
+#include "common/ray_tracing/ray.h"
+#include "common/ray_tracing/bvh.h"
+#include "common/ray_tracing/triangle.h"
+#include "common/ray_tracing/ray_statistics.h"
+
+constexpr int WIDE_BVH_WIDTH = 8;
+
+/*
+ * Node of the wide hierarchy. The bounds of all the children are stored as structure of arrays,
+ * so that one vectorized slab test culls every child at once, the slots from child_count on are empty.
+ */
+struct WideBVHNode {
+    alignas(32) float min_x[WIDE_BVH_WIDTH], min_y[WIDE_BVH_WIDTH], min_z[WIDE_BVH_WIDTH];
+    alignas(32) float max_x[WIDE_BVH_WIDTH], max_y[WIDE_BVH_WIDTH], max_z[WIDE_BVH_WIDTH];
+
+    // interior child: index of its node, leaf child: index of its first triangle block
+    unsigned int child[WIDE_BVH_WIDTH];
+
+    // number of triangle blocks of a leaf child, zero for an interior child
+    unsigned int block_count[WIDE_BVH_WIDTH];
+
+    int child_count;
+};
+
+/*
+ * WIDE_BVH_WIDTH-ary hierarchy collapsed from the binary BVH, the child with the largest surface area is opened
+ * until a node is full. Every leaf keeps its triangles in blocks of TRIANGLE_BLOCK_SIZE tested against a ray at once.
+ * Fewer and wider nodes mean fewer dependent node fetches and fewer unpredictable branches per incoherent ray.
+ */
+class WideBVH {
+    // a node or a leaf waiting in the traversal stack with the distance at which the ray enters it
+    struct StackEntry {
+        unsigned int index;
+        unsigned int block_count;
+        float entry;
+    };
+
+    unsigned int collapse(const BVH &bvh, unsigned int binary_index);
+
+    // slab test of all the children, returns the mask of the children hit and their entry distances
+    unsigned int intersect_children(const WideBVHNode &node, const Ray &ray, float t_min, float t_max, float *entry) const {
+        unsigned int mask = 0;
+
+        #pragma omp simd reduction(|: mask)
+        for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++) {
+            float tx1 = (node.min_x[slot] - ray.base.x) * ray.inv_dir.x;
+            float tx2 = (node.max_x[slot] - ray.base.x) * ray.inv_dir.x;
+            float ty1 = (node.min_y[slot] - ray.base.y) * ray.inv_dir.y;
+            float ty2 = (node.max_y[slot] - ray.base.y) * ray.inv_dir.y;
+            float tz1 = (node.min_z[slot] - ray.base.z) * ray.inv_dir.z;
+            float tz2 = (node.max_z[slot] - ray.base.z) * ray.inv_dir.z;
+
+            float slab_entry = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::max(std::min(tz1, tz2), t_min));
+            float slab_exit = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::min(std::max(tz1, tz2), t_max));
+
+            entry[slot] = slab_entry;
+            mask |= (unsigned int) ((slab_entry <= slab_exit) & (slot < node.child_count)) << slot;
+        }
+
+        return mask;
+    }
+
+public:
+    // every level of the binary hierarchy adds at most WIDE_BVH_WIDTH - 1 pending entries
+    static constexpr int max_stack_size = BVH::max_depth * (WIDE_BVH_WIDTH - 1) + 1;
+
+    std::vector<WideBVHNode> nodes;
+    std::vector<TriangleBlock> blocks;
+
+    // copy of the primitives of the binary hierarchy, the blocks refer to them by index
+    std::vector<BVHPrimitive> primitives;
+
+    void build(const BVH &bvh);
+
+    // closest intersection with t in (t_min, t_max), the children are visited from the nearest entry on
+    HitRecord closest_hit(const Ray &ray, float t_min, float t_max) const;
+
+    // same contract as BVH::any_hit, the primitive index given to the visitor refers to primitives
+    template<typename Visitor>
+    bool any_hit(const Ray &ray, float t_min, float t_max, Visitor &&visitor) const {
+        if (nodes.empty()) return false;
+
+        TraversalCounts counts;
+
+        std::array<StackEntry, max_stack_size> stack;
+        int stack_size = 0;
+        stack[stack_size++] = {0, 0, t_min};
+
+        alignas(32) float entry[WIDE_BVH_WIDTH];
+        alignas(32) int hit[TRIANGLE_BLOCK_SIZE];
+        alignas(32) float t[TRIANGLE_BLOCK_SIZE], u[TRIANGLE_BLOCK_SIZE], v[TRIANGLE_BLOCK_SIZE], w[TRIANGLE_BLOCK_SIZE];
+
+        while (stack_size > 0) {
+            auto current = stack[--stack_size];
+
+            counts.nodes_visited++;
+            if (current.block_count > 0) {
+                counts.triangle_tests += current.block_count * TRIANGLE_BLOCK_SIZE;
+                for (auto b = current.index; b < current.index + current.block_count; b++) {
+                    auto &block = blocks[b];
+                    if (block.intersect(ray, t_min, t_max, hit, t, u, v, w) == 0) continue;
+
+                    for (int slot = 0; slot < TRIANGLE_BLOCK_SIZE; slot++) {
+                        if (hit[slot] and visitor(block.primitive[slot], t[slot], u[slot], v[slot], w[slot])) {
+                            return true;
+                        }
+                    }
+                }
+                continue;
+            }
+
+            auto &node = nodes[current.index];
+            counts.box_tests += node.child_count;
+            auto mask = intersect_children(node, ray, t_min, t_max, entry);
+
+            for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++) {
+                if (mask >> slot & 1) {
+                    stack[stack_size++] = {node.child[slot], node.block_count[slot], entry[slot]};
+                }
+            }
+        }
+
+        return false;
+    }
+};
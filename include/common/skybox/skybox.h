@@ -1,8 +1,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image/stb_image.h"
+#include "common/io/image_cache.h"
 
 #include <iostream>
 #include <vector>
@@ -12,6 +11,9 @@ class SkyBox {
     public:
         unsigned int ID, VAO, VBO;
 
+        // the decoded faces stay in the image cache for the ray tracer, in the order of the faces given
+        std::vector<ImageHandle> images;
+
         std::vector<float> skyboxVertices = {
             // positions          
             -1.0f,  1.0f, -1.0f,
@@ -82,18 +84,16 @@ class SkyBox {
             glGenTextures(1, &ID);
             glBindTexture(GL_TEXTURE_CUBE_MAP, ID);
 
-            int width, height, channel;
+            // the six faces are decoded in parallel
+            images = ImageCache::instance().load(faces);
             for (int i = 0; i < faces.size(); i++) {
-                auto face = faces[i];
-                unsigned char *data = stbi_load(face.c_str(), &width, &height, &channel, 0);
-                if (data != nullptr) {
+                auto &image = images[i];
+                if (image != nullptr) {
                     glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
-                         0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
+                         0, GL_RGB, image->width, image->height, 0, GL_RGB, GL_UNSIGNED_BYTE, image->pixels
                     );
-                    stbi_image_free(data);
                 } else {
-                    std::cout << "Cubemap texture failed to load at path: " << face << std::endl;
-                    stbi_image_free(data);
+                    std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
                 }
             }
 
@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <vector>
+
+#include "common/constructor/constructor.hxx"
+#include "common/io/scene_config.h"
+#include "common/io/image_output.h"
+#include "common/math/vector_field.hxx"
+#include "common/simulation/solid_entity.hxx"
+#include "common/ray_tracing/ray_tracing.h"
+
+#ifndef TEXTURE_DIR
+#define TEXTURE_DIR "./texture"
+#endif
+
+/*
+ * A frame by frame ray traced simulation: a grid of spheres falls towards the origin through
+ * SolidEntity::update_in_vector_field, as in the scene demo, and one more sphere wobbles by moving its vertices.
+ * Every frame the scene is refitted and rendered, and a scene built from scratch renders the same frame
+ * to check the refit and to compare the cost of the two.
+ */
+int main(int argc, char **argv) {
+    int frame_count = 60;
+    int grid = 8;
+    int size = 256;
+    std::string output_prefix;
+
+    // low enough that the wobbling sphere is rebuilt during the default run, so that the comparison covers rebuilds
+    float rebuild_cost_ratio = 1.2f;
+
+    if (argc >= 2) frame_count = std::stoi(argv[1]);
+    if (argc >= 3) grid = std::stoi(argv[2]);
+    if (argc >= 4) size = std::stoi(argv[3]);
+    if (argc >= 5) output_prefix = argv[4];
+    if (argc >= 6) rebuild_cost_ratio = std::stof(argv[5]);
+
+    auto models = ray_tracing_demo_models(TEXTURE_DIR);
+    auto first_entity = models.size();
+    auto spheres = sphere_grid_models(grid);
+    // every other sphere of the grid is a mirror, as on a checkerboard
+    for (int k = 0; k < int(spheres.size()); k++) {
+        spheres[k].reflection = (k / grid + k % grid) % 2 == 0;
+        models.push_back(std::move(spheres[k]));
+    }
+
+    unsigned int wobble_index = models.size();
+    models.push_back(Constructor::Sphere(Point3d(-1.5, 1, 0), 0.3));
+    models.back().object_color = {0.2, 0.4, 1};
+
+    // blended, so that the opacity of its triangles must follow them when its hierarchy is rebuilt
+    models.back().blending = true;
+    models.back().load_texture(std::format("{}/mirror.png", TEXTURE_DIR), diffuse_texture);
+    auto rest_vertices = models.back().vertices;
+
+    auto wobble = [&](float time) {
+        auto &vertices = models[wobble_index].vertices;
+        for (size_t v = 0; v < vertices.size(); v++) {
+            auto &rest = rest_vertices[v].point;
+            vertices[v].point = rest * (1 + 0.15f * std::sin(6 * rest.y + 4 * time));
+        }
+    };
+
+    // the wobbling sphere is deformed before the first build, so it does not share the mesh of the others
+    wobble(0);
+
+    // the field of the scene demo
+    VectorField field([](glm::vec3 pos) {
+        float len = glm::length(pos);
+        return len > 0.1 ? glm::normalize(-pos) / (len * len) : pos;
+    });
+
+    std::vector<SolidEntity> entities(models.size() - 1 - first_entity);
+    for (size_t e = 0; e < entities.size(); e++) {
+        auto &model = models[first_entity + e];
+        entities[e].model = std::optional<std::reference_wrapper<MeshModel>>{model};
+
+        // a sideways start so that the spheres circle the origin instead of meeting there
+        auto center = glm::vec3(model.transform[3]);
+        entities[e].velocity = glm::vec3(-center.y, center.x, 0.5f) * 0.3f;
+    }
+
+    std::vector<std::reference_wrapper<MeshModel>> mesh_models(models.begin(), models.end());
+
+    using clock = std::chrono::steady_clock;
+
+    auto start = clock::now();
+    Scene scene(mesh_models);
+    scene.rebuild_cost_ratio = rebuild_cost_ratio;
+    auto first_build_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    Camera camera(glm::vec3(0.5, 0.5, 5.0f), glm::vec3(0, 1.0f, 0));
+    RayTracingSettings settings;
+    settings.samples_per_pixel = 1;
+
+    FrameBuffer refitted(size, size), reference(size, size);
+
+    double refit_time = 0, build_time = 0, render_time = 0;
+    int rebuild_count = 0;
+    size_t mismatches = 0;
+
+    constexpr float delta_time = 1.0f / 30;
+    for (int frame = 0; frame < frame_count; frame++) {
+        for (auto &entity: entities) {
+            entity.update_in_vector_field(field, delta_time);
+        }
+        wobble(frame * delta_time);
+
+        start = clock::now();
+        rebuild_count += scene.refit({wobble_index});
+        refit_time += std::chrono::duration<double>(clock::now() - start).count();
+
+        start = clock::now();
+        Scene built(mesh_models);
+        build_time += std::chrono::duration<double>(clock::now() - start).count();
+
+        start = clock::now();
+        ray_tracing(camera, scene, refitted, settings);
+        render_time += std::chrono::duration<double>(clock::now() - start).count();
+
+        ray_tracing(camera, built, reference, settings);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                mismatches += refitted.color(x, y) != reference.color(x, y);
+            }
+        }
+
+        if (not output_prefix.empty()) {
+            write_image(refitted, std::format("{}{:04}.ppm", output_prefix, frame));
+        }
+    }
+
+    std::cout << std::format("{} models, {} meshes, {} triangles, first build {:.2f} ms\n",
+                             models.size(), scene.meshes.size(), scene.triangle_count(), first_build_time * 1e3);
+    std::cout << std::format("{} frames of {}x{}: refit {:.3f} ms, build {:.3f} ms per frame, speedup {:.1f}x\n",
+                             frame_count, size, size, refit_time / frame_count * 1e3, build_time / frame_count * 1e3, build_time / refit_time);
+    std::cout << std::format("render {:.1f} ms per frame, {} rebuilds after refit, {} pixels differ from the built scene\n",
+                             render_time / frame_count * 1e3, rebuild_count, mismatches);
+
+    return 0;
+}
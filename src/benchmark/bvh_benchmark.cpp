@@ -0,0 +1,113 @@
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "common/io/scene_config.h"
+#include "common/ray_tracing/bvh.h"
+#include "common/ray_tracing/wide_bvh.h"
+
+#ifndef TEXTURE_DIR
+#define TEXTURE_DIR "./texture"
+#endif
+
+/*
+ * Incoherent rays, as spawned by reflections and refractions: random origins inside the scene bounds
+ * with random directions, traced through the binary BVH and through the wide BVH collapsed from it.
+ */
+int main(int argc, char **argv) {
+    int ray_count = 1 << 20;
+    int grid = 10;
+
+    if (argc >= 2) ray_count = std::stoi(argv[1]);
+    if (argc >= 3) grid = std::stoi(argv[2]);
+
+    auto models = ray_tracing_demo_models(TEXTURE_DIR);
+    auto spheres = sphere_grid_models(grid);
+    models.insert(models.end(), std::make_move_iterator(spheres.begin()), std::make_move_iterator(spheres.end()));
+
+    std::vector<std::reference_wrapper<MeshModel>> mesh_models(models.begin(), models.end());
+
+    using clock = std::chrono::steady_clock;
+
+    auto start = clock::now();
+    BVH bvh;
+    bvh.build(mesh_models);
+    auto binary_build_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    start = clock::now();
+    WideBVH wide_bvh;
+    wide_bvh.build(bvh);
+    auto wide_build_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    auto &root = bvh.nodes[0].box;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::normal_distribution<float> normal(0, 1);
+
+    std::vector<Ray> rays;
+    rays.reserve(ray_count);
+    for (int i = 0; i < ray_count; i++) {
+        glm::vec3 origin {
+            root.x_range.start + unit(gen) * (root.x_range.end - root.x_range.start),
+            root.y_range.start + unit(gen) * (root.y_range.end - root.y_range.start),
+            root.z_range.start + unit(gen) * (root.z_range.end - root.z_range.start)
+        };
+        rays.emplace_back(origin, glm::normalize(glm::vec3 {normal(gen), normal(gen), normal(gen)}));
+    }
+
+    constexpr float inf = std::numeric_limits<float>::infinity();
+
+    std::vector<HitRecord> binary_records(ray_count), wide_records(ray_count);
+
+    start = clock::now();
+    for (int i = 0; i < ray_count; i++) {
+        binary_records[i] = bvh.closest_hit(rays[i], 1e-5, inf);
+    }
+    auto binary_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    start = clock::now();
+    for (int i = 0; i < ray_count; i++) {
+        wide_records[i] = wide_bvh.closest_hit(rays[i], 1e-5, inf);
+    }
+    auto wide_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    // occlusion up to a fixed distance, stopping at the first hit
+    size_t binary_occluded = 0, wide_occluded = 0;
+
+    start = clock::now();
+    for (auto &ray: rays) {
+        binary_occluded += bvh.any_hit(ray, 1e-5, 2.0f, [](auto...) { return true; });
+    }
+    auto binary_any_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    start = clock::now();
+    for (auto &ray: rays) {
+        wide_occluded += wide_bvh.any_hit(ray, 1e-5, 2.0f, [](auto...) { return true; });
+    }
+    auto wide_any_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    size_t hits = 0, mismatches = 0;
+    for (int i = 0; i < ray_count; i++) {
+        hits += binary_records[i].hit;
+        if (binary_records[i].hit != wide_records[i].hit or binary_records[i].t != wide_records[i].t) {
+            mismatches++;
+        }
+    }
+
+    double rays_m = ray_count * 1e-6;
+
+    std::cout << std::format("{} triangles, {} binary nodes, {} wide nodes, {} triangle blocks\n",
+                             bvh.primitives.size(), bvh.nodes.size(), wide_bvh.nodes.size(), wide_bvh.blocks.size());
+    std::cout << std::format("build: binary {:.3f} s, collapse {:.3f} s\n", binary_build_time, wide_build_time);
+    std::cout << std::format("closest hit: binary {:.2f} Mrays/s, wide {:.2f} Mrays/s, speedup {:.2f}x\n",
+                             rays_m / binary_time, rays_m / wide_time, binary_time / wide_time);
+    std::cout << std::format("any hit:     binary {:.2f} Mrays/s, wide {:.2f} Mrays/s, speedup {:.2f}x\n",
+                             rays_m / binary_any_time, rays_m / wide_any_time, binary_any_time / wide_any_time);
+    std::cout << std::format("{} hits, {} mismatches, occluded {} / {}\n", hits, mismatches, binary_occluded, wide_occluded);
+
+    return 0;
+}
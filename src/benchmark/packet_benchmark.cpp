@@ -0,0 +1,105 @@
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include "common/camera/camera.hxx"
+#include "common/io/scene_config.h"
+#include "common/ray_tracing/ray_tracing.h"
+#include "common/ray_tracing/scene.h"
+#include "common/ray_tracing/random.h"
+
+#ifndef TEXTURE_DIR
+#define TEXTURE_DIR "./texture"
+#endif
+
+/*
+ * Primary visibility only: the jittered camera rays of the viewer scene traced one by one through Scene::intersect
+ * and as packets of RAY_PACKET_SIZE neighbouring pixels, optionally with a grid of spheres behind the scene.
+ */
+int main(int argc, char **argv) {
+    int size = 1024;
+    int samples = 4;
+    int grid = 0;
+
+    if (argc >= 2) size = std::stoi(argv[1]);
+    if (argc >= 3) samples = std::stoi(argv[2]);
+    if (argc >= 4) grid = std::stoi(argv[3]);
+
+    auto models = ray_tracing_demo_models(TEXTURE_DIR);
+    auto spheres = sphere_grid_models(grid);
+    models.insert(models.end(), std::make_move_iterator(spheres.begin()), std::make_move_iterator(spheres.end()));
+
+    std::vector<std::reference_wrapper<MeshModel>> mesh_models(models.begin(), models.end());
+    Scene scene(mesh_models);
+
+    // the image plane of ray_tracing()
+    Camera camera(glm::vec3(0.5, 0.5, 5.0f), glm::vec3(0, 1.0f, 0));
+    auto plane = image_plane(camera, size, size);
+    auto base = plane.base;
+    auto up = plane.up;
+    auto right = plane.right;
+
+    auto primary_ray = [&](int i, int j, int k) {
+        RandomStream random(i * size + j, k);
+        auto view_point = base - (up * float(i)) + (right * float(j));
+        auto delta_i = random.next_float();
+        auto delta_j = random.next_float();
+        view_point += (-up * delta_i + right * delta_j);
+        return Ray(camera.position, view_point - camera.position);
+    };
+
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    using clock = std::chrono::steady_clock;
+
+    std::vector<HitRecord> single(size_t(size) * size * samples);
+    std::vector<HitRecord> packed(single.size());
+
+    auto start = clock::now();
+    for (int i = 0; i < size; i++) {
+        for (int k = 0; k < samples; k++) {
+            for (int j = 0; j < size; j++) {
+                single[(size_t(i) * samples + k) * size + j] = scene.intersect(primary_ray(i, j, k), 1e-5, inf);
+            }
+        }
+    }
+    auto single_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    start = clock::now();
+    std::array<HitRecord, RAY_PACKET_SIZE> records;
+    for (int i = 0; i < size; i++) {
+        for (int k = 0; k < samples; k++) {
+            for (int j_begin = 0; j_begin < size; j_begin += RAY_PACKET_SIZE) {
+                int lanes = std::min(RAY_PACKET_SIZE, size - j_begin);
+
+                RayPacket packet;
+                for (int lane = 0; lane < lanes; lane++) {
+                    packet.set(lane, primary_ray(i, j_begin + lane, k), inf);
+                }
+
+                scene.intersect(packet, 1e-5, records);
+                std::copy_n(records.begin(), lanes, packed.begin() + (size_t(i) * samples + k) * size + j_begin);
+            }
+        }
+    }
+    auto packet_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    size_t hits = 0, mismatches = 0;
+    for (size_t r = 0; r < single.size(); r++) {
+        hits += single[r].hit;
+        if (single[r].hit != packed[r].hit or (single[r].hit and single[r].t != packed[r].t)) {
+            mismatches++;
+        }
+    }
+
+    double rays = double(single.size());
+
+    std::cout << std::format("{}x{} pixels, {} samples, {} triangles, {} hits\n", size, size, samples, scene.triangle_count(), hits);
+    std::cout << std::format("single rays: {:.3f} s, {:.2f} Mrays/s\n", single_time, rays / single_time * 1e-6);
+    std::cout << std::format("packets of {}: {:.3f} s, {:.2f} Mrays/s\n", RAY_PACKET_SIZE, packet_time, rays / packet_time * 1e-6);
+    std::cout << std::format("speedup {:.2f}x, {} mismatches\n", single_time / packet_time, mismatches);
+
+    return 0;
+}
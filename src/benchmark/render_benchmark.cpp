@@ -0,0 +1,442 @@
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include "common/camera/camera.hxx"
+#include "common/constructor/constructor.hxx"
+#include "common/mesh_model.hxx"
+#include "common/io/model_io.h"
+#include "common/io/scene_config.h"
+#include "common/ray_tracing/ray_tracing.h"
+
+#ifndef TEXTURE_DIR
+#define TEXTURE_DIR "./texture"
+#endif
+
+#ifndef MODEL_DIR
+#define MODEL_DIR "./model"
+#endif
+
+#ifndef BASELINE_PATH
+#define BASELINE_PATH "./render_baseline.txt"
+#endif
+
+/*
+ * Renders fixed scenes from fixed cameras, without a window or a GL context, for several thread counts and compares
+ * the results with a stored baseline, to catch performance regressions of the ray tracer. The scenes are the spheres,
+ * cubes and mirrors of the ray tracing viewer, the nanosuit on its own and thousands of instances of one cube.
+ *
+ * Every configuration is rendered repeat times from a scene built anew and the fastest run is kept, the time to image
+ * being the build of the scene and the render. The rays are counted once per scene by a render with RenderStatistics,
+ * kept out of the timed runs as the counters slow them down, since the same seed traces the same rays for any thread
+ * count, and every timed run must give the image of that render.
+ *
+ * Exits with 1 when a configuration is slower than the baseline by more than the tolerance, renders another image, or
+ * is missing from the baseline, the last one only without --allow-missing-baseline.
+ */
+
+struct Options {
+    int width {512};
+    int height {512};
+    int samples_per_pixel {4};
+    int repeat {3};
+
+    // the stress scene is a square of instance_grid x instance_grid boxes
+    int instance_grid {64};
+
+    // powers of two up to the hardware threads and the hardware threads themselves when empty
+    std::vector<int> thread_counts;
+
+    // every scene when empty
+    std::vector<std::string> scenes;
+
+    std::string texture_root {TEXTURE_DIR};
+    std::string model_root {MODEL_DIR};
+    std::string baseline_path {BASELINE_PATH};
+
+    // write the results as the new baseline instead of comparing them with it
+    bool save_baseline {false};
+
+    // a configuration missing from the baseline fails the run unless this is set
+    bool allow_missing_baseline {false};
+
+    // a run this much slower than the baseline, in throughput or in time to image, is a regression
+    double tolerance {0.1};
+};
+
+struct BenchmarkScene {
+    std::string name;
+    std::vector<MeshModel> models;
+    glm::vec3 camera_position;
+    std::vector<Light> lights {default_lights()};
+};
+
+struct BenchmarkResult {
+    std::string scene;
+    size_t triangle_count;
+    int thread_count;
+    double build_seconds;
+    double render_seconds;
+    double mrays_per_second;
+    double peak_megabytes;
+    bool same_image;
+
+    double image_seconds() const { return build_seconds + render_seconds; }
+};
+
+struct BaselineEntry {
+    double mrays_per_second;
+    double image_seconds;
+};
+
+void print_usage(const char *program) {
+    std::cout << std::format("usage: {} [options]\n", program)
+              << "  --width <n>              image width (512)\n"
+              << "  --height <n>             image height (512)\n"
+              << "  --spp <n>                samples per pixel (4)\n"
+              << "  --threads <n,n,...>      thread counts to run, powers of two up to every hardware thread by default\n"
+              << "  --repeat <n>             runs of every configuration, the fastest is kept (3)\n"
+              << "  --scene <name>           demo, nanosuit or instances, may be repeated, every scene by default\n"
+              << "  --instance-grid <n>      the instances scene is n x n boxes (64)\n"
+              << "  --baseline <path>        stored results to compare with (" BASELINE_PATH ")\n"
+              << "  --save-baseline          store the results as the baseline instead of comparing them\n"
+              << "  --allow-missing-baseline pass when the baseline has no results for a configuration\n"
+              << "  --tolerance <fraction>   slowdown over the baseline reported as a regression (0.1)\n"
+              << "  --texture-dir <path>     directory of container.jpg and mirror.png\n"
+              << "  --model-dir <path>       directory holding nanosuit/nanosuit.obj\n";
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        // the next argument as the value of the flag
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                std::cerr << std::format("missing value for {}\n", arg);
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--help" or arg == "-h") {
+            print_usage(argv[0]);
+            std::exit(0);
+        } else if (arg == "--width") {
+            options.width = std::atoi(value());
+        } else if (arg == "--height") {
+            options.height = std::atoi(value());
+        } else if (arg == "--spp") {
+            options.samples_per_pixel = std::atoi(value());
+        } else if (arg == "--threads") {
+            std::stringstream list(value());
+            std::string count;
+            while (std::getline(list, count, ',')) {
+                options.thread_counts.push_back(std::atoi(count.c_str()));
+            }
+        } else if (arg == "--repeat") {
+            options.repeat = std::atoi(value());
+        } else if (arg == "--scene") {
+            std::string name = value();
+            if (name != "demo" and name != "nanosuit" and name != "instances") {
+                std::cerr << std::format("unknown scene {}\n", name);
+                return false;
+            }
+            options.scenes.push_back(name);
+        } else if (arg == "--instance-grid") {
+            options.instance_grid = std::atoi(value());
+        } else if (arg == "--baseline") {
+            options.baseline_path = value();
+        } else if (arg == "--save-baseline") {
+            options.save_baseline = true;
+        } else if (arg == "--allow-missing-baseline") {
+            options.allow_missing_baseline = true;
+        } else if (arg == "--tolerance") {
+            options.tolerance = std::atof(value());
+        } else if (arg == "--texture-dir") {
+            options.texture_root = value();
+        } else if (arg == "--model-dir") {
+            options.model_root = value();
+        } else {
+            std::cerr << std::format("unknown option {}\n", arg);
+            return false;
+        }
+    }
+
+    if (options.width <= 0 or options.height <= 0 or options.samples_per_pixel <= 0 or options.repeat <= 0 or
+        options.instance_grid <= 0) {
+        std::cerr << "width, height, spp, repeat and instance grid must be positive\n";
+        return false;
+    }
+
+    if (std::ranges::any_of(options.thread_counts, [](int count) { return count <= 0; })) {
+        std::cerr << "thread counts must be positive\n";
+        return false;
+    }
+
+    if (options.thread_counts.empty()) {
+        int hardware_threads = TileScheduler::resolve_thread_count(0);
+        for (int count = 1; count < hardware_threads; count *= 2) {
+            options.thread_counts.push_back(count);
+        }
+        options.thread_counts.push_back(hardware_threads);
+    }
+
+    return true;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the peak memory is measured from here on where the system can reset it, from the start of the process elsewhere
+void reset_peak_memory() {
+#ifdef __linux__
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+// the peak resident memory of the process in megabytes, zero where it is not known
+double peak_memory_megabytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return double(counters.PeakWorkingSetSize) / (1024.0 * 1024.0);
+    }
+#elif defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.starts_with("VmHWM:")) {
+            return std::atof(line.c_str() + 6) / 1024.0;
+        }
+    }
+#endif
+    return 0;
+}
+
+// the scene of the ray tracing viewer without the nanosuit, seen from the start position of its camera
+BenchmarkScene demo_scene(const Options &options) {
+    return {"demo", ray_tracing_demo_models(options.texture_root), {0.5, 0.5, 5.0f}};
+}
+
+// the whole suit in the frame, empty when the model is missing
+BenchmarkScene nanosuit_scene(const Options &options) {
+    BenchmarkScene scene {"nanosuit", {}, {0, 7.75f, 22}};
+
+    auto model_path = std::format("{}/nanosuit/nanosuit.obj", options.model_root);
+    if (std::filesystem::exists(model_path)) {
+        scene.models = ModelIO(false).read_obj_model(model_path);
+    }
+    return scene;
+}
+
+/*
+ * Boxes of a few depths and heights in a fixed pattern, all placed copies of one unit cube, so the scene holds a
+ * single mesh and the top level hierarchy does most of the work. Some of them are mirrors.
+ */
+BenchmarkScene instances_scene(const Options &options) {
+    int grid = options.instance_grid;
+    float half = float(grid) / 2;
+
+    // the vertical field of view of the ray tracer is 45 degrees
+    BenchmarkScene scene {"instances", {}, {0, 0, half * 2.5f + 2}};
+
+    Light light;
+    light.position = {-half / 2, half / 2, float(grid)};
+    scene.lights = {light};
+
+    scene.models.reserve(size_t(grid) * grid);
+    for (int i = 0; i < grid; i++) {
+        for (int j = 0; j < grid; j++) {
+            float x = float(j) - half;
+            float y = float(i) - half;
+            float depth = -float((i * 7 + j * 13) % 5);
+            float height = 0.3f + 0.1f * float((i * 3 + j * 5) % 7);
+
+            auto model = Constructor::PlacedCubic({x, y, depth}, {x + 0.7f, y + 0.7f, depth + height});
+            model.object_color = {0.3f + 0.1f * float(i % 8), 0.3f + 0.1f * float(j % 8), 0.6f};
+            model.reflection = (i + j) % 11 == 0;
+            scene.models.push_back(std::move(model));
+        }
+    }
+    return scene;
+}
+
+// results of the same scene, threads, resolution and samples are compared, other runs are not comparable
+std::string baseline_key(const std::string &scene, int thread_count, const Options &options) {
+    return std::format("{} {} {} {} {}", scene, thread_count, options.width, options.height, options.samples_per_pixel);
+}
+
+// one line per configuration: scene threads width height spp mrays_per_second image_seconds
+std::map<std::string, BaselineEntry> read_baseline(const std::string &path) {
+    std::map<std::string, BaselineEntry> baseline;
+
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() or line[0] == '#') continue;
+
+        std::stringstream fields(line);
+        std::string scene;
+        int thread_count, width, height, samples_per_pixel;
+        BaselineEntry entry;
+        if (fields >> scene >> thread_count >> width >> height >> samples_per_pixel >> entry.mrays_per_second >> entry.image_seconds) {
+            baseline[std::format("{} {} {} {} {}", scene, thread_count, width, height, samples_per_pixel)] = entry;
+        }
+    }
+    return baseline;
+}
+
+bool write_baseline(const std::string &path, const std::vector<BenchmarkResult> &results, const Options &options) {
+    std::ofstream file(path);
+    file << "# scene threads width height spp mrays_per_second image_seconds\n";
+    for (auto &result: results) {
+        file << std::format("{} {:.4f} {:.6f}\n", baseline_key(result.scene, result.thread_count, options),
+                            result.mrays_per_second, result.image_seconds());
+    }
+    return bool(file);
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (not parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto wanted = [&](const std::string &name) {
+        return options.scenes.empty() or std::ranges::find(options.scenes, name) != options.scenes.end();
+    };
+
+    using clock = std::chrono::steady_clock;
+
+    std::cout << std::format("{}x{}, {} spp, best of {} runs\n", options.width, options.height, options.samples_per_pixel, options.repeat)
+              << std::format("{:<10} {:>9} {:>7} {:>8} {:>9} {:>8} {:>8} {:>8}\n",
+                             "scene", "triangles", "threads", "build s", "render s", "image s", "Mrays/s", "peak MB");
+
+    std::vector<BenchmarkResult> results;
+
+    const std::vector<std::pair<std::string, BenchmarkScene (*)(const Options &)>> scene_makers {
+        {"demo", demo_scene}, {"nanosuit", nanosuit_scene}, {"instances", instances_scene}
+    };
+
+    for (auto &[name, make_scene]: scene_makers) {
+        if (not wanted(name)) continue;
+
+        auto benchmark_scene = make_scene(options);
+
+        if (benchmark_scene.models.empty()) {
+            std::cerr << std::format("no models for scene {}, skipped\n", benchmark_scene.name);
+            continue;
+        }
+
+        // the references are taken once the vector no longer grows
+        std::vector<std::reference_wrapper<MeshModel>> mesh_models(benchmark_scene.models.begin(), benchmark_scene.models.end());
+        Camera camera(benchmark_scene.camera_position, glm::vec3(0, 1.0f, 0));
+
+        RayTracingSettings settings;
+        settings.samples_per_pixel = options.samples_per_pixel;
+
+        RenderStatistics statistics;
+        FrameBuffer reference(options.width, options.height);
+        size_t triangle_count;
+        {
+            Scene scene(mesh_models, benchmark_scene.lights);
+            triangle_count = scene.triangle_count();
+
+            settings.statistics = &statistics;
+            ray_tracing(camera, scene, reference, settings);
+            settings.statistics = nullptr;
+        }
+        double rays = double(statistics.counters.rays());
+
+        for (int thread_count: options.thread_counts) {
+            settings.thread_count = thread_count;
+            reset_peak_memory();
+
+            BenchmarkResult best {benchmark_scene.name, triangle_count, thread_count, 0, std::numeric_limits<double>::infinity(), 0, 0, true};
+            for (int run = 0; run < options.repeat; run++) {
+                auto build_start = clock::now();
+                Scene scene(mesh_models, benchmark_scene.lights);
+                double build_seconds = seconds_since(build_start);
+
+                FrameBuffer framebuffer(options.width, options.height);
+                auto render_start = clock::now();
+                ray_tracing(camera, scene, framebuffer, settings);
+                double render_seconds = seconds_since(render_start);
+
+                best.same_image = best.same_image and framebuffer.find_channel("color")->data == reference.find_channel("color")->data;
+                if (build_seconds + render_seconds < best.image_seconds()) {
+                    best.build_seconds = build_seconds;
+                    best.render_seconds = render_seconds;
+                }
+            }
+            best.mrays_per_second = rays / best.render_seconds * 1e-6;
+            best.peak_megabytes = peak_memory_megabytes();
+
+            std::cout << std::format("{:<10} {:>9} {:>7} {:>8.3f} {:>9.3f} {:>8.3f} {:>8.2f} {:>8.1f}{}\n",
+                                     best.scene, best.triangle_count, best.thread_count, best.build_seconds, best.render_seconds,
+                                     best.image_seconds(), best.mrays_per_second, best.peak_megabytes,
+                                     best.same_image ? "" : "  image differs");
+            results.push_back(best);
+        }
+    }
+
+    if (options.save_baseline) {
+        if (not write_baseline(options.baseline_path, results, options)) {
+            std::cerr << std::format("failed to write {}\n", options.baseline_path);
+            return 1;
+        }
+        std::cout << std::format("baseline written to {}\n", options.baseline_path);
+        return 0;
+    }
+
+    bool failed = std::ranges::any_of(results, [](auto &result) { return not result.same_image; });
+
+    auto baseline = read_baseline(options.baseline_path);
+    if (baseline.empty()) {
+        std::cout << std::format("no baseline in {}, --save-baseline stores one\n", options.baseline_path);
+        return failed or not options.allow_missing_baseline ? 1 : 0;
+    }
+
+    std::cout << std::format("\ncompared with {}, {:.0f}% tolerance\n", options.baseline_path, options.tolerance * 100)
+              << std::format("{:<10} {:>7} {:>9} {:>9}\n", "scene", "threads", "Mrays/s", "image s");
+
+    for (auto &result: results) {
+        auto entry = baseline.find(baseline_key(result.scene, result.thread_count, options));
+        if (entry == baseline.end()) {
+            std::cout << std::format("{:<10} {:>7}   not in the baseline\n", result.scene, result.thread_count);
+            failed = failed or not options.allow_missing_baseline;
+            continue;
+        }
+
+        double throughput_change = result.mrays_per_second / entry->second.mrays_per_second - 1;
+        double time_change = result.image_seconds() / entry->second.image_seconds - 1;
+        bool regression = throughput_change < -options.tolerance or time_change > options.tolerance;
+        failed = failed or regression;
+
+        std::cout << std::format("{:<10} {:>7} {:>+8.1f}% {:>+8.1f}%{}\n", result.scene, result.thread_count,
+                                 throughput_change * 100, time_change * 100, regression ? "  regression" : "");
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "common/mesh_model.hxx"
+#include "common/ray_tracing/texture_sampling.h"
+#include "common/ray_tracing/float_texture.h"
+
+#ifndef TEXTURE_DIR
+#define TEXTURE_DIR "./texture"
+#endif
+
+/*
+ * Texture lookups of the CPU ray tracer: get_texture() on the raw bytes against the FloatTexture filters,
+ * for uv coordinates in scanline order, as the hits of one primary ray tile, and in random order.
+ */
+int main(int argc, char **argv) {
+    int lookup_count = 1 << 22;
+    std::string path = std::format("{}/container.jpg", TEXTURE_DIR);
+
+    if (argc >= 2) lookup_count = std::stoi(argv[1]);
+    if (argc >= 3) path = argv[2];
+
+    MeshModel model;
+    if (not model.load_texture(path, diffuse_texture)) {
+        std::cout << std::format("cannot read {}\n", path);
+        return 1;
+    }
+    auto &texture = model.textures[0];
+
+    using clock = std::chrono::steady_clock;
+
+    auto start = clock::now();
+    FloatTexture float_texture(texture);
+    auto convert_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    size_t texel_count = 0;
+    for (auto &level: float_texture.levels) {
+        texel_count += level.texels.size();
+    }
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> unit(0, 1);
+
+    // scanline order walks a 1024 wide image over the whole texture
+    std::vector<glm::vec2> scanline_uv(lookup_count), random_uv(lookup_count);
+    std::vector<float> lod(lookup_count);
+    for (int k = 0; k < lookup_count; k++) {
+        scanline_uv[k] = {float(k % 1024) / 1024, float(k / 1024 % 1024) / 1024};
+        random_uv[k] = {unit(gen), unit(gen)};
+        lod[k] = unit(gen) * float(float_texture.levels.size() - 1);
+    }
+
+    glm::vec4 checksum {0};
+    std::vector<glm::vec4> batch(lookup_count);
+
+    auto measure = [&](const std::string &name, auto &&lookup) {
+        for (auto *uv: {&scanline_uv, &random_uv}) {
+            auto begin = clock::now();
+            for (int k = 0; k < lookup_count; k++) {
+                checksum += lookup((*uv)[k], lod[k]);
+            }
+            double time = std::chrono::duration<double>(clock::now() - begin).count();
+            std::cout << std::format("{:<20} {:<9} {:7.2f} M lookups/s\n", name, uv == &scanline_uv ? "scanline" : "random",
+                                     lookup_count / time * 1e-6);
+        }
+    };
+
+    std::cout << std::format("{}x{} texture, {} channels, {} levels, converted in {:.1f} ms to {:.1f} MB\n",
+                             texture.width, texture.height, texture.num_channels, float_texture.levels.size(),
+                             convert_time * 1e3, texel_count * sizeof(glm::vec4) / 1048576.0);
+
+    measure("get_texture", [&](glm::vec2 uv, float) { return glm::vec4(get_texture(texture, uv.x, uv.y), 1); });
+    measure("nearest", [&](glm::vec2 uv, float) { return float_texture.nearest(uv); });
+    measure("bilinear", [&](glm::vec2 uv, float) { return float_texture.bilinear(uv); });
+    measure("trilinear", [&](glm::vec2 uv, float l) { return float_texture.trilinear(uv, l); });
+
+    for (auto *uv: {&scanline_uv, &random_uv}) {
+        auto begin = clock::now();
+        float_texture.sample(uv->data(), lod.data(), lookup_count, TextureFilter::bilinear, batch.data());
+        double time = std::chrono::duration<double>(clock::now() - begin).count();
+        checksum += batch[lookup_count / 2];
+        std::cout << std::format("{:<20} {:<9} {:7.2f} M lookups/s\n", "bilinear batch", uv == &scanline_uv ? "scanline" : "random",
+                                 lookup_count / time * 1e-6);
+    }
+
+    std::cout << std::format("checksum {:.3f}\n", checksum.x + checksum.y + checksum.z + checksum.w);
+
+    return 0;
+}
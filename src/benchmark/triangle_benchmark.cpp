@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "common/ray_tracing/ray.h"
+#include "common/ray_tracing/triangle.h"
+
+/*
+ * Micro benchmark of the ray triangle kernels:
+ * Ray::ray_triangle_intersection against the precomputed Möller–Trumbore test of TriangleBuffer
+ */
+int main(int argc, char **argv) {
+    int triangle_count = 4096;
+    int ray_count = 2048;
+
+    if (argc >= 2) triangle_count = std::stoi(argv[1]);
+    if (argc >= 3) ray_count = std::stoi(argv[2]);
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> position(-1, 1);
+    std::uniform_real_distribution<float> offset(-0.2, 0.2);
+
+    std::vector<glm::vec3> vertices;
+    TriangleBuffer triangles;
+    triangles.reserve(triangle_count);
+
+    for (int i = 0; i < triangle_count; i++) {
+        glm::vec3 v0 {position(gen), position(gen), position(gen)};
+        glm::vec3 v1 = v0 + glm::vec3 {offset(gen), offset(gen), offset(gen)};
+        glm::vec3 v2 = v0 + glm::vec3 {offset(gen), offset(gen), offset(gen)};
+        vertices.insert(vertices.end(), {v0, v1, v2});
+        triangles.push_back(v0, v1, v2);
+    }
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < ray_count; i++) {
+        glm::vec3 origin {position(gen), position(gen), 3};
+        glm::vec3 target {position(gen), position(gen), position(gen)};
+        rays.emplace_back(origin, target - origin);
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    // keep the results alive so that the loops are not optimized away
+    size_t reference_hits = 0, kernel_hits = 0, mismatches = 0;
+    float reference_sum = 0, kernel_sum = 0;
+
+    auto start = clock::now();
+    for (auto &ray: rays) {
+        for (int i = 0; i < triangle_count; i++) {
+            auto [flag, t, u, v, w] = ray.ray_triangle_intersection(vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]);
+            if (flag) {
+                reference_hits++;
+                reference_sum += t;
+            }
+        }
+    }
+    auto reference_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    start = clock::now();
+    for (auto &ray: rays) {
+        float t, u, v, w;
+        for (int i = 0; i < triangle_count; i++) {
+            if (triangles.intersect(ray, i, 1e-8f, std::numeric_limits<float>::infinity(), t, u, v, w)) {
+                kernel_hits++;
+                kernel_sum += t;
+            }
+        }
+    }
+    auto kernel_time = std::chrono::duration<double>(clock::now() - start).count();
+
+    // compare both kernels on the first rays
+    for (int r = 0; r < std::min(ray_count, 64); r++) {
+        for (int i = 0; i < triangle_count; i++) {
+            auto [flag, t_ref, u_ref, v_ref, w_ref] = rays[r].ray_triangle_intersection(vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]);
+            float t, u, v, w;
+            bool hit = triangles.intersect(rays[r], i, 1e-8f, std::numeric_limits<float>::infinity(), t, u, v, w);
+            if (flag != hit or (hit and std::fabs(t - t_ref) > 1e-4f * std::max(1.0f, t_ref))) {
+                mismatches++;
+            }
+        }
+    }
+
+    double tests = double(triangle_count) * ray_count;
+
+    std::cout << std::format("{} rays x {} triangles\n", ray_count, triangle_count);
+    std::cout << std::format("ray_triangle_intersection: {:.2f} ns/test, {} hits, t sum {}\n", reference_time * 1e9 / tests, reference_hits, reference_sum);
+    std::cout << std::format("TriangleBuffer::intersect: {:.2f} ns/test, {} hits, t sum {}\n", kernel_time * 1e9 / tests, kernel_hits, kernel_sum);
+    std::cout << std::format("speedup {:.2f}x, {} mismatches on the checked rays\n", reference_time / kernel_time, mismatches);
+
+    return 0;
+}
@@ -40,8 +40,6 @@ MeshModel Constructor::Cubic(Point3d point1, Point3d point2) {
             }
         }
 
-        std::cout << model.vertices.size() << ' ' << vertices.size() << ' ' << model.faces_indices.size() << std::endl;
-
         std::ranges::copy(vertices, std::back_inserter(model.vertices));
         std::ranges::copy(indices, std::back_inserter(model.faces_indices));
 
@@ -65,6 +63,15 @@ MeshModel Constructor::Cubic(Point3d point1, Point3d point2) {
     return model;
 }
 
+MeshModel Constructor::PlacedCubic(Point3d point1, Point3d point2) {
+    auto model = Cubic({0, 0, 0}, {1, 1, 1});
+
+    model.transform = glm::translate(glm::mat4(1.0f), glm::vec3(point1.x, point1.y, point1.z));
+    model.transform = glm::scale(model.transform, glm::vec3(point2.x - point1.x, point2.y - point1.y, point2.z - point1.z));
+
+    return model;
+}
+
 /*
  * Construct a sphere:
  *      Step1: Generate the mesh of unit sphere
@@ -0,0 +1,130 @@
+#include "common/io/image_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image/stb_image.h"
+
+#include "common/ray_tracing/tile_scheduler.h"
+
+namespace {
+    // 64 bit FNV-1a
+    uint64_t hash_bytes(const std::string &bytes) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (unsigned char byte: bytes) {
+            hash = (hash ^ byte) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+}
+
+Image::~Image() {
+    if (pixels != nullptr) {
+        stbi_image_free(pixels);
+    }
+}
+
+ImageCache &ImageCache::instance() {
+    static ImageCache cache;
+    return cache;
+}
+
+ImageHandle ImageCache::find_path(const std::string &path) const {
+    auto known = by_path.find(path);
+    return known == by_path.end() ? nullptr : known->second.lock();
+}
+
+ImageHandle ImageCache::load_file(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (not file) return nullptr;
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto content_hash = hash_bytes(bytes);
+
+    auto find_content = [&]() -> ImageHandle {
+        auto known = by_content.find(content_hash);
+        if (known == by_content.end()) return nullptr;
+        auto image = known->second.lock();
+        if (image) by_path[path] = image;
+        return image;
+    };
+
+    {
+        std::lock_guard lock(mutex);
+        if (auto image = find_content()) return image;
+    }
+
+    auto image = std::make_shared<Image>();
+    image->path = path;
+    image->content_hash = content_hash;
+    image->pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(bytes.data()), int(bytes.size()),
+                                          &image->width, &image->height, &image->num_channels, 0);
+    if (image->pixels == nullptr) return nullptr;
+
+    // another thread may have decoded the same bytes meanwhile, its image is kept
+    std::lock_guard lock(mutex);
+    if (auto cached = find_content()) return cached;
+
+    by_content[content_hash] = image;
+    by_path[path] = image;
+    return image;
+}
+
+ImageHandle ImageCache::load(const std::string &path) {
+    {
+        std::lock_guard lock(mutex);
+        if (auto image = find_path(path)) return image;
+    }
+    return load_file(path);
+}
+
+std::vector<ImageHandle> ImageCache::load(const std::vector<std::string> &paths, int thread_count) {
+    std::vector<ImageHandle> images(paths.size());
+
+    // the first index of every path that is not cached, a path given twice is read once
+    std::vector<size_t> pending;
+    {
+        std::lock_guard lock(mutex);
+        for (size_t i = 0; i < paths.size(); i++) {
+            images[i] = find_path(paths[i]);
+            if (images[i]) continue;
+
+            bool repeated = std::any_of(pending.begin(), pending.end(), [&](size_t p) { return paths[p] == paths[i]; });
+            if (not repeated) pending.push_back(i);
+        }
+    }
+
+    std::atomic<size_t> next {0};
+    auto worker = [&]() {
+        for (auto k = next++; k < pending.size(); k = next++) {
+            images[pending[k]] = load_file(paths[pending[k]]);
+        }
+    };
+
+    int worker_count = std::min(TileScheduler::resolve_thread_count(thread_count), int(pending.size()));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < worker_count; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    // the repeated paths share the image of their first occurrence
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (images[i]) continue;
+        auto first = std::find(paths.begin(), paths.end(), paths[i]) - paths.begin();
+        images[i] = images[first];
+    }
+
+    return images;
+}
+
+size_t ImageCache::size() {
+    std::lock_guard lock(mutex);
+    return std::count_if(by_content.begin(), by_content.end(), [](auto &entry) { return not entry.second.expired(); });
+}
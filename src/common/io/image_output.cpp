@@ -0,0 +1,389 @@
+#include "common/io/image_output.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "common/ray_tracing/tile_scheduler.h"
+
+namespace {
+    // reads linear rgb from a channel of the framebuffer
+    struct ChannelReader {
+        const FrameBufferChannel &channel;
+        int width;
+
+        glm::vec3 rgb(int x, int y) const {
+            const float *pixel = channel.data.data() + (size_t(y) * width + x) * channel.components;
+            if (channel.components < 3) return glm::vec3(pixel[0]);
+            return {pixel[0], pixel[1], pixel[2]};
+        }
+    };
+
+    float tone_map(float value, ToneMapping tone_mapping) {
+        value = std::max(value, 0.0f);
+        switch (tone_mapping) {
+            case ToneMapping::reinhard:
+                value = value / (1.0f + value);
+                break;
+            case ToneMapping::aces:
+                value = value * (2.51f * value + 0.03f) / (value * (2.43f * value + 0.59f) + 0.14f);
+                break;
+            case ToneMapping::clamp:
+                break;
+        }
+        return std::min(value, 1.0f);
+    }
+
+    unsigned char to_byte(float value, const ImageOutputSettings &settings) {
+        value = tone_map(value * settings.exposure, settings.tone_mapping);
+        if (settings.srgb) {
+            value = value <= 0.0031308f ? 12.92f * value : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        }
+        return (unsigned char) (value * 255.99f);
+    }
+
+    // encode(chunk_index, row_begin, row_end, bytes) fills the bytes of every chunk of rows, chunks run in parallel
+    template<typename Encoder>
+    std::vector<std::string> encode_chunks(int height, const ImageOutputSettings &settings, Encoder &&encode) {
+        int chunk_rows = std::max(1, settings.chunk_rows);
+        int chunk_count = (height + chunk_rows - 1) / chunk_rows;
+        std::vector<std::string> chunks(chunk_count);
+
+        int thread_count = std::min(TileScheduler::resolve_thread_count(settings.thread_count), std::max(1, chunk_count));
+        std::atomic<int> next_chunk {0};
+
+        auto worker = [&]() {
+            for (int k = next_chunk++; k < chunk_count; k = next_chunk++) {
+                encode(k, k * chunk_rows, std::min(height, (k + 1) * chunk_rows), chunks[k]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int t = 1; t < thread_count; t++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread: threads) {
+            thread.join();
+        }
+
+        return chunks;
+    }
+
+    void put_u32_big_endian(std::string &bytes, uint32_t value) {
+        bytes.push_back(char(value >> 24));
+        bytes.push_back(char(value >> 16));
+        bytes.push_back(char(value >> 8));
+        bytes.push_back(char(value));
+    }
+
+    void put_f32_little_endian(std::string &bytes, float value) {
+        auto bits = std::bit_cast<uint32_t>(value);
+        bytes.push_back(char(bits));
+        bytes.push_back(char(bits >> 8));
+        bytes.push_back(char(bits >> 16));
+        bytes.push_back(char(bits >> 24));
+    }
+
+    uint32_t crc32(const char *data, size_t size, uint32_t crc = 0) {
+        static const auto table = []() {
+            std::array<uint32_t, 256> table {};
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) {
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                table[n] = c;
+            }
+            return table;
+        }();
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ (unsigned char) data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    constexpr uint32_t adler_base = 65521;
+
+    uint32_t adler32(const std::string &bytes) {
+        uint32_t a = 1, b = 0;
+        size_t i = 0;
+        while (i < bytes.size()) {
+            // 5552 is the largest block for which b cannot overflow before the reduction
+            size_t block_end = std::min(bytes.size(), i + 5552);
+            for (; i < block_end; i++) {
+                a += (unsigned char) bytes[i];
+                b += a;
+            }
+            a %= adler_base;
+            b %= adler_base;
+        }
+        return (b << 16) | a;
+    }
+
+    // checksum of the concatenation from the checksums of both parts, as adler32_combine of zlib
+    uint32_t adler32_combine(uint32_t first, uint32_t second, size_t second_size) {
+        uint32_t remainder = second_size % adler_base;
+        uint32_t a = first & 0xFFFF;
+        uint32_t b = (remainder * a) % adler_base;
+        a += (second & 0xFFFF) + adler_base - 1;
+        b += (first >> 16) + (second >> 16) + adler_base - remainder;
+        if (a >= adler_base) a -= adler_base;
+        if (a >= adler_base) a -= adler_base;
+        if (b >= 2 * adler_base) b -= 2 * adler_base;
+        if (b >= adler_base) b -= adler_base;
+        return (b << 16) | a;
+    }
+
+    std::string png_chunk(const char *type, const std::string &data) {
+        std::string chunk;
+        chunk.reserve(data.size() + 12);
+        put_u32_big_endian(chunk, data.size());
+        chunk.append(type, 4);
+        chunk += data;
+        put_u32_big_endian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        return chunk;
+    }
+
+    void write_ppm(const FrameBuffer &framebuffer, const ChannelReader &reader, std::ostream &stream,
+                   const ImageOutputSettings &settings) {
+        auto chunks = encode_chunks(framebuffer.height, settings, [&](int, int row_begin, int row_end, std::string &bytes) {
+            bytes.reserve(size_t(row_end - row_begin) * framebuffer.width * 3);
+            for (int y = row_begin; y < row_end; y++) {
+                for (int x = 0; x < framebuffer.width; x++) {
+                    auto pixel = reader.rgb(x, y);
+                    bytes.push_back(char(to_byte(pixel.r, settings)));
+                    bytes.push_back(char(to_byte(pixel.g, settings)));
+                    bytes.push_back(char(to_byte(pixel.b, settings)));
+                }
+            }
+        });
+
+        stream << "P6\n" << framebuffer.width << ' ' << framebuffer.height << "\n255\n";
+        for (auto &chunk: chunks) {
+            stream.write(chunk.data(), chunk.size());
+        }
+    }
+
+    void write_pfm(const FrameBuffer &framebuffer, const ChannelReader &reader, std::ostream &stream,
+                   const ImageOutputSettings &settings) {
+        // the rows of a pfm go from the bottom to the top
+        auto chunks = encode_chunks(framebuffer.height, settings, [&](int, int row_begin, int row_end, std::string &bytes) {
+            bytes.reserve(size_t(row_end - row_begin) * framebuffer.width * 12);
+            for (int y = row_end - 1; y >= row_begin; y--) {
+                for (int x = 0; x < framebuffer.width; x++) {
+                    auto pixel = reader.rgb(x, y) * settings.exposure;
+                    put_f32_little_endian(bytes, pixel.r);
+                    put_f32_little_endian(bytes, pixel.g);
+                    put_f32_little_endian(bytes, pixel.b);
+                }
+            }
+        });
+
+        // a negative scale marks little endian data
+        stream << "PF\n" << framebuffer.width << ' ' << framebuffer.height << "\n-1.0\n";
+        for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); chunk++) {
+            stream.write(chunk->data(), chunk->size());
+        }
+    }
+
+    /*
+     * The image data is a zlib stream made of stored deflate blocks, so nothing is compressed
+     * but every chunk of rows becomes an independent IDAT chunk that is encoded on its own thread.
+     */
+    void write_png(const FrameBuffer &framebuffer, const ChannelReader &reader, std::ostream &stream,
+                   const ImageOutputSettings &settings) {
+        constexpr size_t max_block_size = 65535;
+        size_t row_size = size_t(framebuffer.width) * 3 + 1;
+
+        std::vector<uint32_t> chunk_adler;
+        std::vector<size_t> chunk_raw_size;
+        int chunk_count = (framebuffer.height + std::max(1, settings.chunk_rows) - 1) / std::max(1, settings.chunk_rows);
+        chunk_adler.resize(chunk_count);
+        chunk_raw_size.resize(chunk_count);
+
+        auto chunks = encode_chunks(framebuffer.height, settings, [&](int k, int row_begin, int row_end, std::string &bytes) {
+            // scanlines with filter type none
+            std::string raw;
+            raw.reserve((row_end - row_begin) * row_size);
+            for (int y = row_begin; y < row_end; y++) {
+                raw.push_back(0);
+                for (int x = 0; x < framebuffer.width; x++) {
+                    auto pixel = reader.rgb(x, y);
+                    raw.push_back(char(to_byte(pixel.r, settings)));
+                    raw.push_back(char(to_byte(pixel.g, settings)));
+                    raw.push_back(char(to_byte(pixel.b, settings)));
+                }
+            }
+            chunk_adler[k] = adler32(raw);
+            chunk_raw_size[k] = raw.size();
+
+            std::string data;
+            data.reserve(raw.size() + (raw.size() / max_block_size + 1) * 5 + 2);
+            if (k == 0) {
+                // zlib header: deflate with a 32K window, no preset dictionary
+                data.push_back(0x78);
+                data.push_back(0x01);
+            }
+            for (size_t offset = 0; offset < raw.size(); offset += max_block_size) {
+                auto block_size = std::min(max_block_size, raw.size() - offset);
+                data.push_back(0);
+                data.push_back(char(block_size));
+                data.push_back(char(block_size >> 8));
+                data.push_back(char(~block_size));
+                data.push_back(char(~block_size >> 8));
+                data.append(raw, offset, block_size);
+            }
+
+            bytes = png_chunk("IDAT", data);
+        });
+
+        uint32_t adler = 1;
+        for (int k = 0; k < chunk_count; k++) {
+            adler = adler32_combine(adler, chunk_adler[k], chunk_raw_size[k]);
+        }
+
+        std::string header;
+        put_u32_big_endian(header, framebuffer.width);
+        put_u32_big_endian(header, framebuffer.height);
+        // 8 bit rgb, deflate, adaptive filtering, no interlace
+        header += std::string {8, 2, 0, 0, 0};
+
+        // an empty final block closes the deflate stream
+        std::string trailer {1, 0, 0, char(0xFF), char(0xFF)};
+        put_u32_big_endian(trailer, adler);
+
+        const char signature[] = {char(0x89), 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        stream.write(signature, sizeof(signature));
+        stream << png_chunk("IHDR", header);
+        for (auto &chunk: chunks) {
+            stream.write(chunk.data(), chunk.size());
+        }
+        stream << png_chunk("IDAT", trailer) << png_chunk("IEND", {});
+    }
+
+    std::array<unsigned char, 4> to_rgbe(const glm::vec3 &color) {
+        float max_component = std::max({color.r, color.g, color.b});
+        if (max_component < 1e-32f) return {0, 0, 0, 0};
+
+        int exponent;
+        float scale = std::frexp(max_component, &exponent) * 256.0f / max_component;
+        return {
+            (unsigned char) (std::max(color.r, 0.0f) * scale),
+            (unsigned char) (std::max(color.g, 0.0f) * scale),
+            (unsigned char) (std::max(color.b, 0.0f) * scale),
+            (unsigned char) (exponent + 128)
+        };
+    }
+
+    /*
+     * Scanlines use the run length layout with literal runs only, readers recognise it from the scanline header.
+     * Widths the layout cannot describe fall back to flat pixels.
+     */
+    void write_hdr(const FrameBuffer &framebuffer, const ChannelReader &reader, std::ostream &stream,
+                   const ImageOutputSettings &settings) {
+        int width = framebuffer.width;
+        bool run_length = width >= 8 and width < 0x8000;
+
+        auto chunks = encode_chunks(framebuffer.height, settings, [&](int, int row_begin, int row_end, std::string &bytes) {
+            std::vector<std::array<unsigned char, 4>> scanline(width);
+            bytes.reserve(size_t(row_end - row_begin) * (width * 4 + width / 32 + 8));
+
+            for (int y = row_begin; y < row_end; y++) {
+                for (int x = 0; x < width; x++) {
+                    scanline[x] = to_rgbe(reader.rgb(x, y) * settings.exposure);
+                }
+
+                if (not run_length) {
+                    for (auto &pixel: scanline) {
+                        bytes.append((const char *) pixel.data(), 4);
+                    }
+                    continue;
+                }
+
+                bytes += std::string {2, 2, char(width >> 8), char(width & 0xFF)};
+                for (int component = 0; component < 4; component++) {
+                    for (int x = 0; x < width; x += 128) {
+                        int count = std::min(128, width - x);
+                        bytes.push_back(char(count));
+                        for (int i = x; i < x + count; i++) {
+                            bytes.push_back(char(scanline[i][component]));
+                        }
+                    }
+                }
+            }
+        });
+
+        stream << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " << framebuffer.height << " +X " << width << '\n';
+        for (auto &chunk: chunks) {
+            stream.write(chunk.data(), chunk.size());
+        }
+    }
+}
+
+ImageFormat image_format_from_path(const std::string &path) {
+    auto dot = path.find_last_of('.');
+    if (dot == std::string::npos) return ImageFormat::ppm;
+
+    std::string extension = path.substr(dot + 1);
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (extension == "pfm") return ImageFormat::pfm;
+    if (extension == "png") return ImageFormat::png;
+    if (extension == "hdr") return ImageFormat::hdr;
+    return ImageFormat::ppm;
+}
+
+bool write_image(const FrameBuffer &framebuffer, std::ostream &stream, const ImageOutputSettings &settings) {
+    auto channel = framebuffer.find_channel(settings.channel);
+    if (channel == nullptr) {
+        std::cerr << std::format("no channel {} in the framebuffer", settings.channel) << std::endl;
+        return false;
+    }
+
+    ChannelReader reader {*channel, framebuffer.width};
+
+    switch (settings.format) {
+        case ImageFormat::pfm:
+            write_pfm(framebuffer, reader, stream, settings);
+            break;
+        case ImageFormat::png:
+            write_png(framebuffer, reader, stream, settings);
+            break;
+        case ImageFormat::hdr:
+            write_hdr(framebuffer, reader, stream, settings);
+            break;
+        case ImageFormat::automatic:
+        case ImageFormat::ppm:
+            write_ppm(framebuffer, reader, stream, settings);
+            break;
+    }
+
+    return bool(stream);
+}
+
+bool write_image(const FrameBuffer &framebuffer, const std::string &path, const ImageOutputSettings &settings) {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (not file) {
+        std::cerr << std::format("cannot open {}", path) << std::endl;
+        return false;
+    }
+
+    auto path_settings = settings;
+    if (path_settings.format == ImageFormat::automatic) {
+        path_settings.format = image_format_from_path(path);
+    }
+
+    return write_image(framebuffer, file, path_settings);
+}
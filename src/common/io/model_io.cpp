@@ -12,10 +12,14 @@ void ModelIO::load_material_texture(aiMaterial *material, aiTextureType type, Me
 
         std::string path = std::format("{}/{}", this->directory, std::string(str.C_Str()));
         std::cout << path << std::endl;
-        if (type == aiTextureType::aiTextureType_DIFFUSE)
-            model.bind_texture(path, TextureType::diffuse_texture);
-        if (type == aiTextureType::aiTextureType_SPECULAR)
-            model.bind_texture(path, TextureType::specular_texture);
+        if (type != aiTextureType::aiTextureType_DIFFUSE and type != aiTextureType::aiTextureType_SPECULAR)
+            continue;
+
+        auto texture_type = type == aiTextureType::aiTextureType_DIFFUSE ? TextureType::diffuse_texture : TextureType::specular_texture;
+        if (upload_textures)
+            model.bind_texture(path, texture_type);
+        else
+            model.load_texture(path, texture_type);
     }
 }
 
@@ -67,6 +71,19 @@ std::vector<MeshModel> ModelIO::read_obj_model(std::string model_path) {
 
     this->directory = model_path.substr(0, model_path.find_last_of('/'));
 
+    // the images of all the materials are decoded in parallel first, the meshes then find them in the cache
+    std::vector<std::string> texture_paths;
+    for (unsigned int m = 0; m < scene->mNumMaterials; m++) {
+        for (auto type: {aiTextureType::aiTextureType_DIFFUSE, aiTextureType::aiTextureType_SPECULAR}) {
+            for (unsigned int i = 0; i < scene->mMaterials[m]->GetTextureCount(type); i++) {
+                aiString str;
+                scene->mMaterials[m]->GetTexture(type, i, &str);
+                texture_paths.push_back(std::format("{}/{}", this->directory, std::string(str.C_Str())));
+            }
+        }
+    }
+    auto images = ImageCache::instance().load(texture_paths);
+
     process_node(scene->mRootNode, scene, res);
 
     return res;
@@ -1,7 +0,0 @@
-#include <iostream>
-#include "common/io/render_output.h"
-
-#include "array"
-#include "glm/glm.hpp"
-#include "fstream"
-
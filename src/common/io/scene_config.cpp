@@ -0,0 +1,91 @@
+#include "common/io/scene_config.h"
+
+#include <format>
+#include <fstream>
+#include <iostream>
+
+#include "common/constructor/constructor.hxx"
+
+std::vector<MeshModel> read_scene_config(const std::string &config_path, const std::string &texture_root) {
+    std::vector<MeshModel> models;
+
+    std::ifstream config_fstream(config_path);
+    if (not config_fstream) {
+        std::cout << std::format("cannot open config {}", config_path) << std::endl;
+        return models;
+    }
+
+    int config_ent_num = 0;
+    config_fstream >> config_ent_num;
+
+    for (int i = 0; i < config_ent_num; i++) {
+        int op;
+        float ax, ay, az, bx, by, bz;
+        if (not (config_fstream >> op >> ax >> ay >> az >> bx >> by >> bz)) break;
+
+        if (op == 0) {
+            auto model = Constructor::PlacedCubic({ax, ay, az}, {bx, by, bz});
+            model.object_color = {0.5, 0.1, 0};
+            models.push_back(std::move(model));
+        } else if (op == 1) {
+            auto model = Constructor::PlacedCubic({ax, ay, az}, {bx, by, bz});
+            model.reflection = true;
+            models.push_back(std::move(model));
+        } else if (op == 2) {
+            auto model = Constructor::Rectangle({ax, ay, az}, {ax, by, az}, {bx, ay, bz});
+            model.blending = true;
+            model.load_texture(std::format("{}/mirror.png", texture_root), diffuse_texture);
+            models.push_back(std::move(model));
+        }
+    }
+
+    return models;
+}
+
+std::vector<MeshModel> ray_tracing_demo_models(const std::string &texture_root) {
+    std::vector<MeshModel> models;
+
+    auto sphere = Constructor::Sphere(Point3d(1.5, 0.5, 0), 0.2);
+    sphere.object_color = {1, 0, 0};
+
+    auto sphere2 = Constructor::Sphere(Point3d(-0.5, -0.5, 1), 0.2);
+    sphere2.object_color = {1, 0, 0};
+
+    auto cubic = Constructor::Cubic({ 1.0, -0.3, -0.5 }, { 2, 0.3, 0.5 });
+    cubic.reflection = true;
+
+    auto cubic2 = Constructor::Cubic({ 0, -0.3, -1.6 }, { 1, 0.3, -1.3 });
+    cubic2.load_texture(std::format("{}/container.jpg", texture_root), diffuse_texture);
+
+    auto mirror = Constructor::Rectangle({-0.5, 0, 0.5}, {-0.5, 1, 0.5}, {0.5, 0, 0.5});
+    mirror.blending = true;
+    mirror.load_texture(std::format("{}/mirror.png", texture_root), diffuse_texture);
+
+    auto mirror2 = Constructor::Rectangle({-0.5, -0.5, 1.5}, {-0.5, 0.5, 1.5}, {0.5, -0.5, 1.5});
+    mirror2.blending = true;
+    mirror2.load_texture(std::format("{}/mirror.png", texture_root), diffuse_texture);
+
+    // same order as the model list of the viewer
+    models.push_back(std::move(sphere));
+    models.push_back(std::move(sphere2));
+    models.push_back(std::move(cubic2));
+    models.push_back(std::move(mirror));
+    models.push_back(std::move(mirror2));
+    models.push_back(std::move(cubic));
+
+    return models;
+}
+
+std::vector<MeshModel> sphere_grid_models(int grid) {
+    std::vector<MeshModel> models;
+
+    for (int i = 0; i < grid; i++) {
+        for (int j = 0; j < grid; j++) {
+            float x = -2 + 4.0f * (i + 0.5f) / grid;
+            float y = -2 + 4.0f * (j + 0.5f) / grid;
+            models.push_back(Constructor::Sphere(Point3d(x, y, -3), 1.5f / grid));
+        }
+    }
+
+    return models;
+}
@@ -1,6 +1,38 @@
 #include "common/math/aabb.hxx"
 
+#include <algorithm>
+
+void AxisAlignedBoundingBox::expand(const glm::vec3 &point) {
+    x_range = Interval(std::min(x_range.start, point.x), std::max(x_range.end, point.x));
+    y_range = Interval(std::min(y_range.start, point.y), std::max(y_range.end, point.y));
+    z_range = Interval(std::min(z_range.start, point.z), std::max(z_range.end, point.z));
+}
+
+void AxisAlignedBoundingBox::expand(const AxisAlignedBoundingBox &box) {
+    x_range = Interval(std::min(x_range.start, box.x_range.start), std::max(x_range.end, box.x_range.end));
+    y_range = Interval(std::min(y_range.start, box.y_range.start), std::max(y_range.end, box.y_range.end));
+    z_range = Interval(std::min(z_range.start, box.z_range.start), std::max(z_range.end, box.z_range.end));
+}
+
+float AxisAlignedBoundingBox::surface_area() const {
+    float dx = x_range.end - x_range.start;
+    float dy = y_range.end - y_range.start;
+    float dz = z_range.end - z_range.start;
+
+    if (dx < 0 or dy < 0 or dz < 0) return 0;
+
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+glm::vec3 AxisAlignedBoundingBox::center() const {
+    return {
+        (x_range.start + x_range.end) * 0.5f,
+        (y_range.start + y_range.end) * 0.5f,
+        (z_range.start + z_range.end) * 0.5f
+    };
+}
+
 std::ostream& operator << (std::ostream& os, AxisAlignedBoundingBox box)  {
     os << std::format("({} {}) ({} {}) ({} {})", box.x_range.start, box.x_range.end, box.y_range.start, box.y_range.end, box.z_range.start, box.z_range.end);
     return os;
-}
\ No newline at end of file
+}
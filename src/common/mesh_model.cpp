@@ -5,7 +5,6 @@
 #include "glad/glad.h"
 #include "glm/gtc/type_ptr.hpp"
 #include "common/camera/camera.hxx"
-#include "stb_image/stb_image.h"
 #include <format>
 
 void MeshModel::set_box(float min_x, float min_y, float min_z, float max_x, float max_y, float max_z) {
@@ -162,31 +161,41 @@ void MeshModel::process_environment_reflection_rendering(Shader& shader, Camera
     glBindVertexArray(0);
 }
 
-void MeshModel::bind_texture(const std::string& texture_path, TextureType type) {
+bool MeshModel::load_texture(const std::string& texture_path, TextureType type) {
     // read the texture image
 
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load(texture_path.c_str(), &width, &height, &nrChannels, 0);
+    // the models and meshes using the same image share its pixels
+    auto image = ImageCache::instance().load(texture_path);
 
-    if (data == nullptr) {
+    if (image == nullptr) {
         std::cout << "read image failed" << std::endl;
+        return false;
+    }
+
+    this->textures.push_back({0, type, texture_path, image->pixels, image->num_channels, image->width, image->height, image});
+
+    return true;
+}
+
+void MeshModel::bind_texture(const std::string& texture_path, TextureType type) {
+    if (not load_texture(texture_path, type)) {
         return;
     }
 
-    Texture texture {0, type, texture_path, data, nrChannels, width, height};
+    auto &texture = this->textures.back();
 
     glGenTextures(1, &texture.id);
     glBindTexture(GL_TEXTURE_2D, texture.id);
 
     GLenum format;
-    if (nrChannels == 1)
+    if (texture.num_channels == 1)
         format = GL_RED;
-    else if (nrChannels == 3)
+    else if (texture.num_channels == 3)
         format = GL_RGB;
-    else if (nrChannels == 4)
+    else if (texture.num_channels == 4)
         format = GL_RGBA;
 
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, texture.width, texture.height, 0, format, GL_UNSIGNED_BYTE, texture.data);
     glGenerateMipmap(GL_TEXTURE_2D);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -196,36 +205,24 @@ void MeshModel::bind_texture(const std::string& texture_path, TextureType type)
     std::cout << "texture id " << texture.id<< std::endl;
 
     glBindTexture(GL_TEXTURE_2D, 0);
-
-    this->textures.push_back(texture);
-
-//    stbi_image_free(data);
 }
 
 void MeshModel::bind_texture_with_alpha(const std::string& texture_path, TextureType type) {
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load(texture_path.c_str(), &width, &height, &nrChannels, 0);
-
-    if (data == nullptr) {
-        std::cout << "read image failed" << std::endl;
+    if (not load_texture(texture_path, type)) {
         return;
     }
 
     this->blending = true;
 
-    Texture texture {0, type, texture_path, data, nrChannels, width, height};
+    auto &texture = this->textures.back();
 
     glGenTextures(1, &texture.id);
     glBindTexture(GL_TEXTURE_2D, texture.id);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.width, texture.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.data);
     glGenerateMipmap(GL_TEXTURE_2D);
 
     glBindTexture(GL_TEXTURE_2D, 0);
-
-    this->textures.push_back(texture);
-
-//    stbi_image_free(data);
 }
 
 float MeshModel::get_distance(glm::vec3 pos) const {
@@ -0,0 +1,303 @@
+#include "common/ray_tracing/bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace {
+    float axis_of(const glm::vec3 &vec, int axis) {
+        return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+    }
+}
+
+void BVH::build(const std::vector<std::reference_wrapper<MeshModel>> &mesh_models) {
+    nodes.clear();
+    primitives.clear();
+    triangles.clear();
+
+    std::vector<BVHPrimitive> scene_primitives;
+    std::vector<BuildItem> items;
+
+    for (unsigned int k = 0; k < mesh_models.size(); k++) {
+        auto &model = mesh_models[k].get();
+        for (unsigned int f = 0; f < model.faces_indices.size(); f++) {
+            auto &tri = model.faces_indices[f];
+
+            BuildItem item;
+            item.box.expand(model.vertices[tri.x].point);
+            item.box.expand(model.vertices[tri.y].point);
+            item.box.expand(model.vertices[tri.z].point);
+            item.centroid = item.box.center();
+            item.primitive = scene_primitives.size();
+
+            items.push_back(item);
+            scene_primitives.push_back({k, f});
+        }
+    }
+
+    if (items.empty()) return;
+
+    nodes.reserve(2 * items.size());
+    build_node(nodes, items, 0, items.size(), 0);
+
+    // store the primitives and their vertices in leaf order
+    primitives.reserve(items.size());
+    triangles.reserve(items.size());
+    for (auto &item: items) {
+        auto primitive = scene_primitives[item.primitive];
+        auto &model = mesh_models[primitive.model_index].get();
+        auto &tri = model.faces_indices[primitive.face_index];
+
+        primitives.push_back(primitive);
+        triangles.push_back(model.vertices[tri.x].point, model.vertices[tri.y].point, model.vertices[tri.z].point);
+    }
+}
+
+void BVH::refit(const std::vector<std::reference_wrapper<MeshModel>> &mesh_models) {
+    for (size_t i = 0; i < primitives.size(); i++) {
+        auto &model = mesh_models[primitives[i].model_index].get();
+        auto &tri = model.faces_indices[primitives[i].face_index];
+        triangles.set(i, model.vertices[tri.x].point, model.vertices[tri.y].point, model.vertices[tri.z].point);
+    }
+
+    refit_nodes(nodes, [&](const BVHNode &leaf) {
+        AxisAlignedBoundingBox box;
+        for (auto i = leaf.offset; i < leaf.offset + leaf.count; i++) {
+            box.expand(triangles.vertex(i, 0));
+            box.expand(triangles.vertex(i, 1));
+            box.expand(triangles.vertex(i, 2));
+        }
+        return box;
+    });
+}
+
+float BVH::sah_cost(const std::vector<BVHNode> &nodes) {
+    if (nodes.empty()) return 0;
+
+    // the same unit costs as the build, one per box visit and one per triangle
+    float cost = 0;
+    for (auto &node: nodes) {
+        cost += node.box.surface_area() * (node.is_leaf() ? float(node.count) : 1.0f);
+    }
+
+    float root_area = nodes[0].box.surface_area();
+    return root_area > 0 ? cost / root_area : float(nodes[0].count);
+}
+
+unsigned int BVH::build_node(std::vector<BVHNode> &nodes, std::vector<BuildItem> &items, unsigned int begin, unsigned int end, int depth) {
+    unsigned int node_index = nodes.size();
+    nodes.push_back({});
+
+    AxisAlignedBoundingBox box, centroid_box;
+    for (auto i = begin; i < end; i++) {
+        box.expand(items[i].box);
+        centroid_box.expand(items[i].centroid);
+    }
+
+    unsigned int count = end - begin;
+
+    auto make_leaf = [&]() {
+        nodes[node_index] = {box, begin, count};
+        return node_index;
+    };
+
+    // leaves are forced at the maximum depth so that the traversal stack never overflows
+    if (count <= 2 or depth >= max_depth - 1) {
+        return make_leaf();
+    }
+
+    // find the best split plane among the bin borders of all three axes
+    struct Bin {
+        AxisAlignedBoundingBox box;
+        unsigned int count = 0;
+    };
+
+    float best_cost = std::numeric_limits<float>::infinity();
+    int best_axis = -1;
+    int best_split = 0;
+
+    glm::vec3 centroid_min {centroid_box.x_range.start, centroid_box.y_range.start, centroid_box.z_range.start};
+    glm::vec3 centroid_max {centroid_box.x_range.end, centroid_box.y_range.end, centroid_box.z_range.end};
+
+    for (int axis = 0; axis < 3; axis++) {
+        float lower = axis_of(centroid_min, axis);
+        float extent = axis_of(centroid_max, axis) - lower;
+        if (extent <= 0) continue;
+
+        std::array<Bin, bin_count> bins;
+        float scale = bin_count / extent;
+
+        for (auto i = begin; i < end; i++) {
+            int b = std::min(bin_count - 1, int((axis_of(items[i].centroid, axis) - lower) * scale));
+            bins[b].box.expand(items[i].box);
+            bins[b].count++;
+        }
+
+        // sweep from the right to get the area and count of every right part
+        std::array<float, bin_count> right_area {};
+        std::array<unsigned int, bin_count> right_count {};
+        AxisAlignedBoundingBox right_box;
+        unsigned int right_sum = 0;
+        for (int b = bin_count - 1; b > 0; b--) {
+            right_box.expand(bins[b].box);
+            right_sum += bins[b].count;
+            right_area[b] = right_box.surface_area();
+            right_count[b] = right_sum;
+        }
+
+        AxisAlignedBoundingBox left_box;
+        unsigned int left_sum = 0;
+        for (int b = 0; b < bin_count - 1; b++) {
+            left_box.expand(bins[b].box);
+            left_sum += bins[b].count;
+            if (left_sum == 0 or right_count[b + 1] == 0) continue;
+
+            float cost = left_box.surface_area() * left_sum + right_area[b + 1] * right_count[b + 1];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = b + 1;
+            }
+        }
+    }
+
+    // cost of a leaf against the cost of traversing one more level, one unit per triangle test
+    constexpr float traversal_cost = 1.0f;
+    float area = box.surface_area();
+    float leaf_cost = float(count);
+    float split_cost = area > 0 ? traversal_cost + best_cost / area : leaf_cost;
+
+    unsigned int mid;
+    if (best_axis == -1) {
+        // all centroids coincide, split by index if the leaf would be too large
+        if (count <= max_leaf_size) return make_leaf();
+        mid = begin + count / 2;
+    } else {
+        if (split_cost >= leaf_cost and count <= max_leaf_size) return make_leaf();
+
+        float lower = axis_of(centroid_min, best_axis);
+        float scale = bin_count / (axis_of(centroid_max, best_axis) - lower);
+        auto pivot = std::partition(items.begin() + begin, items.begin() + end, [&](const BuildItem &item) {
+            return std::min(bin_count - 1, int((axis_of(item.centroid, best_axis) - lower) * scale)) < best_split;
+        });
+        mid = pivot - items.begin();
+    }
+
+    build_node(nodes, items, begin, mid, depth + 1);
+    unsigned int right = build_node(nodes, items, mid, end, depth + 1);
+
+    nodes[node_index] = {box, right, 0};
+    return node_index;
+}
+
+HitRecord BVH::closest_hit(const Ray &ray, float t_min, float t_max) const {
+    HitRecord record;
+    if (nodes.empty()) return record;
+
+    TraversalCounts counts;
+    counts.box_tests++;
+
+    // pending nodes together with the distance at which the ray enters them
+    std::array<std::pair<unsigned int, float>, max_depth> stack;
+    int stack_size = 0;
+
+    auto root_range = nodes[0].box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max);
+    if (not root_range.is_empty()) {
+        stack[stack_size++] = {0, root_range.start};
+    }
+
+    while (stack_size > 0) {
+        auto [node_index, entry] = stack[--stack_size];
+
+        // a closer hit may have been found since the node was pushed
+        if (entry > t_max) continue;
+
+        auto &node = nodes[node_index];
+        counts.nodes_visited++;
+
+        if (node.is_leaf()) {
+            counts.triangle_tests += node.count;
+            unsigned int hit_index = 0;
+            bool leaf_hit = false;
+            for (auto i = node.offset; i < node.offset + node.count; i++) {
+                if (triangles.intersect(ray, i, t_min, t_max, record.t, record.u, record.v, record.w)) {
+                    t_max = record.t;
+                    hit_index = i;
+                    leaf_hit = true;
+                }
+            }
+            if (leaf_hit) {
+                record.hit = true;
+                record.model_index = primitives[hit_index].model_index;
+                record.face_index = primitives[hit_index].face_index;
+            }
+            continue;
+        }
+
+        counts.box_tests += 2;
+        unsigned int near_child = node_index + 1;
+        unsigned int far_child = node.offset;
+        auto near_range = nodes[near_child].box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max);
+        auto far_range = nodes[far_child].box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max);
+
+        if (far_range.start < near_range.start) {
+            std::swap(near_child, far_child);
+            std::swap(near_range, far_range);
+        }
+
+        // push the far child first so that the near child is visited first and shrinks t_max early
+        if (not far_range.is_empty()) stack[stack_size++] = {far_child, far_range.start};
+        if (not near_range.is_empty()) stack[stack_size++] = {near_child, near_range.start};
+    }
+
+    return record;
+}
+
+void BVH::closest_hit(RayPacket &packet, float t_min, PacketHitRecord &record) const {
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    if (nodes.empty()) return;
+
+    TraversalCounts counts;
+    counts.box_tests += RAY_PACKET_SIZE;
+
+    // pending nodes together with the nearest entry of the lanes into them
+    std::array<std::pair<unsigned int, float>, max_depth> stack;
+    int stack_size = 0;
+
+    float root_entry = packet.entry(nodes[0].box, t_min);
+    if (root_entry < inf) {
+        stack[stack_size++] = {0, root_entry};
+    }
+
+    while (stack_size > 0) {
+        auto [node_index, entry] = stack[--stack_size];
+
+        // every lane may have found a closer hit since the node was pushed
+        if (entry > packet.farthest_t_max()) continue;
+
+        auto &node = nodes[node_index];
+        counts.nodes_visited++;
+
+        if (node.is_leaf()) {
+            counts.triangle_tests += node.count * RAY_PACKET_SIZE;
+            for (auto i = node.offset; i < node.offset + node.count; i++) {
+                triangles.intersect(packet, i, t_min, record);
+            }
+            continue;
+        }
+
+        counts.box_tests += 2 * RAY_PACKET_SIZE;
+        unsigned int near_child = node_index + 1;
+        unsigned int far_child = node.offset;
+        float near_entry = packet.entry(nodes[near_child].box, t_min);
+        float far_entry = packet.entry(nodes[far_child].box, t_min);
+
+        if (far_entry < near_entry) {
+            std::swap(near_child, far_child);
+            std::swap(near_entry, far_entry);
+        }
+
+        if (far_entry < inf) stack[stack_size++] = {far_child, far_entry};
+        if (near_entry < inf) stack[stack_size++] = {near_child, near_entry};
+    }
+}
@@ -0,0 +1,302 @@
+#include "common/ray_tracing/denoiser.h"
+#include "common/ray_tracing/tile_scheduler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <thread>
+
+namespace {
+    using Plane = std::vector<float, AlignedAllocator<float>>;
+
+    // the B3 spline of the a-trous transform, the taps of the kernel along one axis
+    constexpr std::array<float, 5> kernel {1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16};
+
+    // a darker albedo is not divided out, the pixel is filtered with its color as it is
+    constexpr float min_albedo = 1e-3f;
+
+    /*
+     * The weights of the taps are computed without calls, float comparisons nor branches, so that the loop over
+     * a row vectorizes with the default floating point flags: what would compare floats compares their bits.
+     */
+
+    // e^x for x below 88 within 2e-7 relative, 2^x as the power of two nearest to x log2(e) times a series of the rest
+    inline float fast_exp(float x) {
+        // max(x, -87), the bits of the negative floats grow with their magnitude and are above the ones of the others
+        auto bits = std::bit_cast<uint32_t>(x);
+        constexpr auto min_bits = std::bit_cast<uint32_t>(-87.0f);
+        float t = std::bit_cast<float>(bits > min_bits ? min_bits : bits) * 1.44269504f;
+
+        // adding 1.5 * 2^23 leaves the nearest integer in the low bits of the mantissa
+        constexpr float round = 12582912.0f;
+        float shifted = t + round;
+        int32_t whole = std::bit_cast<int32_t>(shifted) - std::bit_cast<int32_t>(round);
+        float f = t - (shifted - round);
+
+        // 2^f = e^(f ln 2) for f in [-0.5, 0.5]
+        float p = 1.5403530e-4f;
+        p = p * f + 1.3333558e-3f;
+        p = p * f + 9.6181291e-3f;
+        p = p * f + 5.5504109e-2f;
+        p = p * f + 2.4022651e-1f;
+        p = p * f + 6.9314718e-1f;
+        p = p * f + 1.0f;
+        return p * std::bit_cast<float>((whole + 127) << 23);
+    }
+
+    // ln |x| within 2e-6 for a normal x, the exponent bits and ln m = 2 atanh((m - 1) / (m + 1)) for the mantissa m
+    inline float fast_log(float x) {
+        auto bits = std::bit_cast<int32_t>(x);
+        float exponent = float(((bits >> 23) & 0xff) - 127);
+        float m = std::bit_cast<float>((bits & 0x7fffff) | 0x3f800000);
+        float s = (m - 1) / (m + 1);
+        float s2 = s * s;
+        return exponent * 0.69314718f + s * (2 + s2 * (2.0f / 3 + s2 * (2.0f / 5 + s2 * (2.0f / 7 + s2 * (2.0f / 9)))));
+    }
+
+    float luminance(float r, float g, float b) {
+        return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+    }
+
+    // body(row_begin, row_end) for bands of rows on thread_count threads, the bands are taken in turn
+    template<typename Body>
+    void for_rows(int height, int thread_count, Body &&body) {
+        constexpr int band_rows = 8;
+        int band_count = (height + band_rows - 1) / band_rows;
+
+        thread_count = std::min(TileScheduler::resolve_thread_count(thread_count), std::max(1, band_count));
+        std::atomic<int> next_band {0};
+
+        auto worker = [&]() {
+            for (int k = next_band++; k < band_count; k = next_band++) {
+                body(k * band_rows, std::min(height, (k + 1) * band_rows));
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int t = 1; t < thread_count; t++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    }
+}
+
+double denoise(FrameBuffer &framebuffer, const DenoiserSettings &settings) {
+    auto start = std::chrono::steady_clock::now();
+    auto seconds = [&]() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    // added first, a new channel may move the others
+    auto &output = framebuffer.add_channel("denoised", 3).data;
+    auto &color_data = framebuffer.find_channel("color")->data;
+    if (not framebuffer.has_auxiliary_channels()) {
+        std::copy(color_data.begin(), color_data.end(), output.begin());
+        return seconds();
+    }
+    auto &albedo_data = framebuffer.find_channel("albedo")->data;
+    auto &normal_data = framebuffer.find_channel("normal")->data;
+    auto &depth_data = framebuffer.find_channel("depth")->data;
+
+    int width = framebuffer.width;
+    int height = framebuffer.height;
+    size_t size = size_t(width) * height;
+    int thread_count = settings.thread_count;
+
+    // one plane per component, so that a tap of the kernel reads a row of neighbours contiguously
+    std::array<Plane, 3> color, next_color;
+    for (int c = 0; c < 3; c++) {
+        color[c].resize(size);
+        next_color[c].resize(size);
+    }
+    Plane variance(size), next_variance(size), filtered_variance(size), luma(size);
+    Plane normal_x(size), normal_y(size), normal_z(size), depth(size), depth_change(size);
+
+    // the albedo divided out of a pixel, or one
+    auto modulation = [&](size_t i, int c) {
+        float albedo = albedo_data[3 * i + c];
+        return albedo > min_albedo ? albedo : 1.0f;
+    };
+
+    for_rows(height, thread_count, [&](int row_begin, int row_end) {
+        for (int y = row_begin; y < row_end; y++) {
+            for (int x = 0; x < width; x++) {
+                auto i = framebuffer.pixel_index(x, y);
+                for (int c = 0; c < 3; c++) {
+                    color[c][i] = color_data[3 * i + c] / modulation(i, c);
+                }
+
+                // the mean of the normals of the samples is shorter at an edge
+                glm::vec3 normal {normal_data[3 * i], normal_data[3 * i + 1], normal_data[3 * i + 2]};
+                if (glm::dot(normal, normal) > 0) {
+                    normal = glm::normalize(normal);
+                }
+                normal_x[i] = normal.x;
+                normal_y[i] = normal.y;
+                normal_z[i] = normal.z;
+                depth[i] = depth_data[i];
+
+                // the variance of the mean, as the lighting is filtered its luminance is divided by the one of the albedo
+                float count = framebuffer.sample_count(x, y);
+                float scale = luminance(modulation(i, 0), modulation(i, 1), modulation(i, 2));
+                variance[i] = count > 1 ? framebuffer.variance(x, y) / count / (scale * scale) : -1.0f;
+            }
+        }
+    });
+
+    for_rows(height, thread_count, [&](int row_begin, int row_end) {
+        for (int y = row_begin; y < row_end; y++) {
+            for (int x = 0; x < width; x++) {
+                auto i = framebuffer.pixel_index(x, y);
+                auto at = [&](const Plane &plane, int dx, int dy) {
+                    return plane[framebuffer.pixel_index(std::clamp(x + dx, 0, width - 1), std::clamp(y + dy, 0, height - 1))];
+                };
+
+                float change_x = std::abs(at(depth, 1, 0) - at(depth, -1, 0));
+                float change_y = std::abs(at(depth, 0, 1) - at(depth, 0, -1));
+                depth_change[i] = 0.5f * std::max(change_x, change_y);
+
+                // a single sample says nothing of the noise, the spread of the 3 x 3 neighbourhood stands for it
+                if (variance[i] < 0) {
+                    float sum = 0, sum_squares = 0;
+                    for (int dy = -1; dy <= 1; dy++) {
+                        for (int dx = -1; dx <= 1; dx++) {
+                            float l = luminance(at(color[0], dx, dy), at(color[1], dx, dy), at(color[2], dx, dy));
+                            sum += l;
+                            sum_squares += l * l;
+                        }
+                    }
+                    float mean = sum / 9;
+                    variance[i] = std::max(0.0f, sum_squares / 9 - mean * mean);
+                }
+            }
+        }
+    });
+
+    for (int iteration = 0; iteration < settings.iterations; iteration++) {
+        int step = 1 << iteration;
+
+        for_rows(height, thread_count, [&](int row_begin, int row_end) {
+            for (size_t i = size_t(row_begin) * width; i < size_t(row_end) * width; i++) {
+                luma[i] = luminance(color[0][i], color[1][i], color[2][i]);
+            }
+        });
+
+        // the variance is blurred by a 3 x 3 gaussian before guiding the weights, a single pixel is too noisy a guide
+        for_rows(height, thread_count, [&](int row_begin, int row_end) {
+            constexpr std::array<float, 3> gaussian {0.25f, 0.5f, 0.25f};
+            for (int y = row_begin; y < row_end; y++) {
+                for (int x = 0; x < width; x++) {
+                    float sum = 0;
+                    for (int dy = -1; dy <= 1; dy++) {
+                        for (int dx = -1; dx <= 1; dx++) {
+                            auto q = framebuffer.pixel_index(std::clamp(x + dx, 0, width - 1), std::clamp(y + dy, 0, height - 1));
+                            sum += gaussian[dx + 1] * gaussian[dy + 1] * variance[q];
+                        }
+                    }
+                    filtered_variance[framebuffer.pixel_index(x, y)] = sum;
+                }
+            }
+        });
+
+        for_rows(height, thread_count, [&](int row_begin, int row_end) {
+            // the sums of the pixels of a row, gathered one tap of the kernel at a time
+            Plane sum_weight(width), sum_r(width), sum_g(width), sum_b(width), sum_variance(width);
+            Plane inv_luma_scale(width), inv_depth_scale(width);
+
+            for (int y = row_begin; y < row_end; y++) {
+                auto row = framebuffer.pixel_index(0, y);
+                std::fill(sum_weight.begin(), sum_weight.end(), 0.0f);
+                std::fill(sum_r.begin(), sum_r.end(), 0.0f);
+                std::fill(sum_g.begin(), sum_g.end(), 0.0f);
+                std::fill(sum_b.begin(), sum_b.end(), 0.0f);
+                std::fill(sum_variance.begin(), sum_variance.end(), 0.0f);
+
+                for (int x = 0; x < width; x++) {
+                    inv_luma_scale[x] = 1 / (settings.color_phi * std::sqrt(std::max(0.0f, filtered_variance[row + x])) + 1e-6f);
+                    inv_depth_scale[x] = 1 / (settings.depth_phi * depth_change[row + x] * float(step) + 1e-6f);
+                }
+
+                for (int dy = -2; dy <= 2; dy++) {
+                    int y_tap = y + dy * step;
+                    if (y_tap < 0 or y_tap >= height) continue;
+
+                    for (int dx = -2; dx <= 2; dx++) {
+                        // the taps beyond the borders are left out, the columns with a tap inside are contiguous
+                        int offset = dx * step;
+                        int x_begin = std::max(0, -offset);
+                        int x_end = std::min(width, width - offset);
+
+                        float kernel_weight = kernel[dx + 2] * kernel[dy + 2];
+                        float inv_distance = dx == 0 and dy == 0 ? 1.0f : 1 / std::sqrt(float(dx * dx + dy * dy));
+                        auto tap_row = framebuffer.pixel_index(0, y_tap) + offset;
+                        float normal_phi = settings.normal_phi;
+
+                        const float *p_normal_x = normal_x.data() + row, *q_normal_x = normal_x.data() + tap_row;
+                        const float *p_normal_y = normal_y.data() + row, *q_normal_y = normal_y.data() + tap_row;
+                        const float *p_normal_z = normal_z.data() + row, *q_normal_z = normal_z.data() + tap_row;
+                        const float *p_depth = depth.data() + row, *q_depth = depth.data() + tap_row;
+                        const float *p_luma = luma.data() + row, *q_luma = luma.data() + tap_row;
+                        const float *q_r = color[0].data() + tap_row, *q_g = color[1].data() + tap_row, *q_b = color[2].data() + tap_row;
+                        const float *q_variance = variance.data() + tap_row;
+
+                        #pragma omp simd
+                        for (int x = x_begin; x < x_end; x++) {
+                            float cosine = p_normal_x[x] * q_normal_x[x] + p_normal_y[x] * q_normal_y[x] + p_normal_z[x] * q_normal_z[x];
+
+                            // the rays that left the scene have neither normal nor depth and are alike
+                            int32_t both_missed = int32_t(std::bit_cast<uint32_t>(p_depth[x]) == 0) & int32_t(std::bit_cast<uint32_t>(q_depth[x]) == 0);
+                            int32_t facing = both_missed | int32_t(std::bit_cast<uint32_t>(cosine) >> 31 ^ 1);
+
+                            // the three weights as one exponential, cosine^phi = e^(phi ln cosine)
+                            float normal_term = float(1 - both_missed) * normal_phi * fast_log(cosine);
+                            float depth_term = std::abs(p_depth[x] - q_depth[x]) * inv_depth_scale[x] * inv_distance;
+                            float luma_term = std::abs(p_luma[x] - q_luma[x]) * inv_luma_scale[x];
+
+                            float weight = float(facing) * kernel_weight * fast_exp(normal_term - depth_term - luma_term);
+                            sum_weight[x] += weight;
+                            sum_r[x] += weight * q_r[x];
+                            sum_g[x] += weight * q_g[x];
+                            sum_b[x] += weight * q_b[x];
+                            sum_variance[x] += weight * weight * q_variance[x];
+                        }
+                    }
+                }
+
+                for (int x = 0; x < width; x++) {
+                    auto i = row + x;
+                    float weight = sum_weight[x];
+                    if (weight <= 0) {
+                        for (int c = 0; c < 3; c++) next_color[c][i] = color[c][i];
+                        next_variance[i] = variance[i];
+                        continue;
+                    }
+                    next_color[0][i] = sum_r[x] / weight;
+                    next_color[1][i] = sum_g[x] / weight;
+                    next_color[2][i] = sum_b[x] / weight;
+                    next_variance[i] = sum_variance[x] / (weight * weight);
+                }
+            }
+        });
+
+        std::swap(color, next_color);
+        std::swap(variance, next_variance);
+    }
+
+    for_rows(height, thread_count, [&](int row_begin, int row_end) {
+        for (size_t i = size_t(row_begin) * width; i < size_t(row_end) * width; i++) {
+            for (int c = 0; c < 3; c++) {
+                output[3 * i + c] = color[c][i] * modulation(i, c);
+            }
+        }
+    });
+
+    return seconds();
+}
@@ -0,0 +1,60 @@
+#include "common/ray_tracing/environment.h"
+
+#include <algorithm>
+#include <cmath>
+
+EnvironmentMap::EnvironmentMap(const std::vector<ImageHandle> &t_faces) {
+    if (t_faces.size() != faces.size()) return;
+    if (std::any_of(t_faces.begin(), t_faces.end(), [](auto &face) { return face == nullptr; })) return;
+
+    std::copy(t_faces.begin(), t_faces.end(), faces.begin());
+}
+
+glm::vec3 EnvironmentMap::texel(const Image &image, int i, int j) const {
+    i = std::clamp(i, 0, image.width - 1);
+    j = std::clamp(j, 0, image.height - 1);
+    auto *p = image.pixels + (size_t(j) * image.width + i) * image.num_channels;
+
+    constexpr float scale = 255.0f;
+    if (image.num_channels < 3) {
+        return glm::vec3(p[0] / scale);
+    }
+    return {p[0] / scale, p[1] / scale, p[2] / scale};
+}
+
+glm::vec3 EnvironmentMap::radiance(glm::vec3 direction) const {
+    if (empty()) return {0, 0, 0};
+
+    // the face of the major axis and the coordinates on it, as in the cube map table of the GL specification
+    auto magnitude = glm::abs(direction);
+    int face;
+    float sc, tc, ma;
+    if (magnitude.x >= magnitude.y and magnitude.x >= magnitude.z) {
+        face = direction.x > 0 ? 0 : 1;
+        sc = direction.x > 0 ? -direction.z : direction.z;
+        tc = -direction.y;
+        ma = magnitude.x;
+    } else if (magnitude.y >= magnitude.z) {
+        face = direction.y > 0 ? 2 : 3;
+        sc = direction.x;
+        tc = direction.y > 0 ? direction.z : -direction.z;
+        ma = magnitude.y;
+    } else {
+        face = direction.z > 0 ? 4 : 5;
+        sc = direction.z > 0 ? direction.x : -direction.x;
+        tc = -direction.y;
+        ma = magnitude.z;
+    }
+    if (ma == 0) return {0, 0, 0};
+
+    auto &image = *faces[face];
+    float x = (sc / ma + 1) * 0.5f * image.width - 0.5f;
+    float y = (tc / ma + 1) * 0.5f * image.height - 0.5f;
+    float x0 = std::floor(x), y0 = std::floor(y);
+    float fx = x - x0, fy = y - y0;
+    int i = int(x0), j = int(y0);
+
+    auto top = glm::mix(texel(image, i, j), texel(image, i + 1, j), fx);
+    auto bottom = glm::mix(texel(image, i, j + 1), texel(image, i + 1, j + 1), fx);
+    return glm::mix(top, bottom, fy) * intensity;
+}
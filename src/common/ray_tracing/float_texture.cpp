@@ -0,0 +1,75 @@
+#include "common/ray_tracing/float_texture.h"
+
+namespace {
+    // a division rather than a product with 1 / 255, so that 255 reads exactly 1
+    glm::vec4 decode_texel(const unsigned char *data, int num_channels) {
+        constexpr float scale = 255.0f;
+        switch (num_channels) {
+            case 1:
+                return {data[0] / scale, data[0] / scale, data[0] / scale, 1};
+            case 2:
+                return {data[0] / scale, data[0] / scale, data[0] / scale, data[1] / scale};
+            case 3:
+                return {data[0] / scale, data[1] / scale, data[2] / scale, 1};
+            default:
+                return {data[0] / scale, data[1] / scale, data[2] / scale, data[3] / scale};
+        }
+    }
+
+    // the 2x2 box filter of the level, an odd last row or column is averaged with itself
+    TextureLevel downsample(const TextureLevel &level) {
+        TextureLevel next;
+        next.width = std::max(1, level.width / 2);
+        next.height = std::max(1, level.height / 2);
+        next.texels.resize(size_t(next.width) * next.height);
+
+        auto at = [&](int i, int j) -> const glm::vec4 & {
+            return level.texels[size_t(std::min(j, level.height - 1)) * level.width + std::min(i, level.width - 1)];
+        };
+
+        for (int j = 0; j < next.height; j++) {
+            for (int i = 0; i < next.width; i++) {
+                next.texels[size_t(j) * next.width + i] =
+                    (at(2 * i, 2 * j) + at(2 * i + 1, 2 * j) + at(2 * i, 2 * j + 1) + at(2 * i + 1, 2 * j + 1)) * 0.25f;
+            }
+        }
+
+        return next;
+    }
+}
+
+FloatTexture::FloatTexture(const Texture &texture, TextureAddress t_address): address(t_address) {
+    if (texture.data == nullptr or texture.width <= 0 or texture.height <= 0) return;
+
+    auto &base = levels.emplace_back();
+    base.width = texture.width;
+    base.height = texture.height;
+    base.texels.resize(size_t(base.width) * base.height);
+
+    for (size_t t = 0; t < base.texels.size(); t++) {
+        base.texels[t] = decode_texel(texture.data + t * texture.num_channels, texture.num_channels);
+    }
+
+    while (levels.back().width > 1 or levels.back().height > 1) {
+        auto next = downsample(levels.back());
+        levels.push_back(std::move(next));
+    }
+}
+
+void FloatTexture::sample(const glm::vec2 *uv, const float *lod, size_t count, TextureFilter filter, glm::vec4 *result) const {
+    if (auto counters = thread_ray_counters) {
+        counters->texture_fetches += count;
+    }
+
+    switch (filter) {
+        case TextureFilter::nearest:
+            for (size_t k = 0; k < count; k++) result[k] = nearest(uv[k]);
+            break;
+        case TextureFilter::bilinear:
+            for (size_t k = 0; k < count; k++) result[k] = bilinear(uv[k]);
+            break;
+        case TextureFilter::trilinear:
+            for (size_t k = 0; k < count; k++) result[k] = trilinear(uv[k], lod[k]);
+            break;
+    }
+}
@@ -0,0 +1,151 @@
+#include "common/ray_tracing/framebuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    float luminance(const glm::vec3 &color) {
+        return 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
+    }
+}
+
+FrameBuffer::FrameBuffer(int t_width, int t_height): width(t_width), height(t_height) {
+    add_channel("color", 3);
+    add_channel("sample_count", 1);
+    add_channel("variance", 1);
+}
+
+FrameBuffer::FrameBuffer(const FrameBuffer &other): channels(other.channels), width(other.width), height(other.height) {
+    bind_standard_channels();
+}
+
+FrameBuffer &FrameBuffer::operator = (const FrameBuffer &other) {
+    if (this != &other) {
+        channels = other.channels;
+        width = other.width;
+        height = other.height;
+        bind_standard_channels();
+    }
+    return *this;
+}
+
+void FrameBuffer::bind_standard_channels() {
+    color_channel = find_channel("color");
+    count_channel = find_channel("sample_count");
+    variance_channel = find_channel("variance");
+    albedo_channel = find_channel("albedo");
+    normal_channel = find_channel("normal");
+    depth_channel = find_channel("depth");
+}
+
+void FrameBuffer::resize(int t_width, int t_height) {
+    width = t_width;
+    height = t_height;
+    for (auto &channel: channels) {
+        channel.data.assign(size_t(width) * height * channel.components, 0.0f);
+    }
+}
+
+void FrameBuffer::clear() {
+    for (auto &channel: channels) {
+        std::fill(channel.data.begin(), channel.data.end(), 0.0f);
+    }
+}
+
+FrameBufferChannel &FrameBuffer::add_channel(const std::string &name, int components) {
+    if (auto channel = find_channel(name)) return *channel;
+
+    channels.push_back({name, components, {}});
+    channels.back().data.assign(size_t(width) * height * components, 0.0f);
+
+    // the vector may have moved the standard channels
+    bind_standard_channels();
+    return channels.back();
+}
+
+void FrameBuffer::add_auxiliary_channels() {
+    add_channel("albedo", 3);
+    add_channel("normal", 3);
+    add_channel("depth", 1);
+}
+
+FrameBufferChannel *FrameBuffer::find_channel(const std::string &name) {
+    auto it = std::ranges::find_if(channels, [&](auto &channel) { return channel.name == name; });
+    return it == channels.end() ? nullptr : &*it;
+}
+
+const FrameBufferChannel *FrameBuffer::find_channel(const std::string &name) const {
+    auto it = std::ranges::find_if(channels, [&](auto &channel) { return channel.name == name; });
+    return it == channels.end() ? nullptr : &*it;
+}
+
+void FrameBuffer::accumulate(int x, int y, const glm::vec3 &sample) {
+    auto index = pixel_index(x, y);
+    float *mean = color_channel->data.data() + 3 * index;
+    float &count = count_channel->data[index];
+    float &m2 = variance_channel->data[index];
+
+    // Welford update of the mean color and of the luminance variance
+    glm::vec3 old_mean {mean[0], mean[1], mean[2]};
+    count += 1;
+    glm::vec3 new_mean = old_mean + (sample - old_mean) / count;
+
+    float sample_luminance = luminance(sample);
+    m2 += (sample_luminance - luminance(old_mean)) * (sample_luminance - luminance(new_mean));
+
+    mean[0] = new_mean.r;
+    mean[1] = new_mean.g;
+    mean[2] = new_mean.b;
+}
+
+void FrameBuffer::accumulate(int x, int y, const AuxiliarySample &sample) {
+    if (not has_auxiliary_channels()) return;
+
+    auto index = pixel_index(x, y);
+    float weight = 1 / std::max(1.0f, count_channel->data[index]);
+
+    float *albedo = albedo_channel->data.data() + 3 * index;
+    float *normal = normal_channel->data.data() + 3 * index;
+    for (int c = 0; c < 3; c++) {
+        albedo[c] += (sample.albedo[c] - albedo[c]) * weight;
+        normal[c] += (sample.normal[c] - normal[c]) * weight;
+    }
+    float &depth = depth_channel->data[index];
+    depth += (sample.depth - depth) * weight;
+}
+
+void FrameBuffer::set_color(int x, int y, const glm::vec3 &color, float count) {
+    auto index = pixel_index(x, y);
+    float *mean = color_channel->data.data() + 3 * index;
+    mean[0] = color.r;
+    mean[1] = color.g;
+    mean[2] = color.b;
+    count_channel->data[index] = count;
+    variance_channel->data[index] = 0;
+}
+
+glm::vec3 FrameBuffer::color(int x, int y) const {
+    const float *mean = color_channel->data.data() + 3 * pixel_index(x, y);
+    return {mean[0], mean[1], mean[2]};
+}
+
+float FrameBuffer::sample_count(int x, int y) const {
+    return count_channel->data[pixel_index(x, y)];
+}
+
+float FrameBuffer::variance(int x, int y) const {
+    auto index = pixel_index(x, y);
+    float count = count_channel->data[index];
+    return count > 1 ? variance_channel->data[index] / (count - 1) : 0.0f;
+}
+
+float FrameBuffer::mean_luminance(int x, int y) const {
+    return luminance(color(x, y));
+}
+
+float FrameBuffer::standard_error(int x, int y) const {
+    float count = sample_count(x, y);
+    if (count < 2) return std::numeric_limits<float>::infinity();
+    return std::sqrt(variance(x, y) / count);
+}
@@ -0,0 +1,119 @@
+#include "common/ray_tracing/light.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+    float luminance(const glm::vec3 &color) {
+        return 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
+    }
+}
+
+float Light::power() const {
+    constexpr float pi = std::numbers::pi_v<float>;
+
+    if (type == LightType::point) {
+        return 4 * pi * luminance(color);
+    }
+    // both sides emit, pi times the area into each hemisphere
+    float area = 0.5f * glm::length(glm::cross(edge1, edge2));
+    return 2 * pi * area * luminance(color);
+}
+
+LightSample Light::sample(glm::vec3 point, float u1, float u2) const {
+    if (type == LightType::point) {
+        return {position, color};
+    }
+
+    // the points of the square beyond the diagonal are folded back onto the triangle, which keeps them uniform
+    if (u1 + u2 > 1) {
+        u1 = 1 - u1;
+        u2 = 1 - u2;
+    }
+    auto on_light = position + edge1 * u1 + edge2 * u2;
+
+    auto to_light = on_light - point;
+    float distance_squared = glm::dot(to_light, to_light);
+    auto normal = glm::cross(edge1, edge2);
+    float normal_length = glm::length(normal);
+    if (distance_squared == 0 or normal_length == 0) {
+        return {on_light, {0, 0, 0}};
+    }
+
+    // area / distance^2 * cos at the light is the solid angle of the triangle, |normal| is twice the area
+    float cos_light = std::abs(glm::dot(normal, to_light)) / (normal_length * std::sqrt(distance_squared));
+    if (cos_light == 0) {
+        return {on_light, {0, 0, 0}};
+    }
+    float solid_angle = 0.5f * normal_length * cos_light / distance_squared;
+    return {on_light, color * solid_angle, 1 / solid_angle};
+}
+
+float Light::pdf(glm::vec3 point, glm::vec3 on_light) const {
+    if (type == LightType::point) return 0;
+
+    auto to_light = on_light - point;
+    float distance_squared = glm::dot(to_light, to_light);
+    auto normal = glm::cross(edge1, edge2);
+    float cos_area = std::abs(glm::dot(normal, to_light)) * 0.5f / std::sqrt(distance_squared);
+    return cos_area > 0 ? distance_squared / cos_area : 0;
+}
+
+std::vector<Light> default_lights() {
+    Light light;
+    light.position = {-7, 7, 10};
+    return {light};
+}
+
+void LightSampler::build(const std::vector<Light> &lights) {
+    auto count = lights.size();
+    keep.assign(count, 1);
+    alias.resize(count);
+    probabilities.resize(count);
+    if (count == 0) return;
+
+    float total = 0;
+    for (size_t i = 0; i < count; i++) {
+        probabilities[i] = std::max(0.0f, lights[i].power());
+        total += probabilities[i];
+    }
+
+    // lights without power, all of them dark for instance, are picked uniformly
+    for (auto &probability: probabilities) {
+        probability = total > 0 ? probability / total : 1.0f / float(count);
+    }
+
+    // the bins below the mean are filled up from the ones above it
+    std::vector<unsigned int> small, large;
+    std::vector<float> scaled(count);
+    for (unsigned int i = 0; i < count; i++) {
+        alias[i] = i;
+        scaled[i] = probabilities[i] * float(count);
+        (scaled[i] < 1 ? small : large).push_back(i);
+    }
+
+    while (not small.empty() and not large.empty()) {
+        auto s = small.back();
+        auto l = large.back();
+        small.pop_back();
+
+        keep[s] = scaled[s];
+        alias[s] = l;
+        scaled[l] -= 1 - scaled[s];
+        if (scaled[l] < 1) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // what is left is one up to rounding
+    for (auto i: small) keep[i] = 1;
+    for (auto i: large) keep[i] = 1;
+}
+
+unsigned int LightSampler::sample(float u) const {
+    float scaled = u * float(keep.size());
+    auto bin = std::min(unsigned(scaled), unsigned(keep.size() - 1));
+    return scaled - float(bin) < keep[bin] ? bin : alias[bin];
+}
@@ -0,0 +1,164 @@
+#include "common/ray_tracing/path_tracing.h"
+#include "common/ray_tracing/ray_tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+namespace {
+    constexpr float pi = std::numbers::pi_v<float>;
+
+    // the weight of a sample of density pdf against the other strategy of density other_pdf
+    float power_heuristic(float pdf, float other_pdf) {
+        float a = pdf * pdf, b = other_pdf * other_pdf;
+        return a + b > 0 ? a / (a + b) : 0;
+    }
+
+    // a cosine distributed direction around the normal, which must be normalized, its density is cos / pi
+    glm::vec3 sample_cosine(glm::vec3 normal, float u1, float u2, float &pdf) {
+        // an orthonormal basis around the normal without a branch on its largest component (Duff et al. 2017)
+        float sign = std::copysign(1.0f, normal.z);
+        float a = -1 / (sign + normal.z);
+        float b = normal.x * normal.y * a;
+        glm::vec3 tangent {1 + sign * normal.x * normal.x * a, sign * b, -sign * normal.x};
+        glm::vec3 bitangent {b, sign + normal.y * normal.y * a, -normal.y};
+
+        float phi = 2 * pi * u1;
+        float radius = std::sqrt(u2);
+        float cos_theta = std::sqrt(std::max(0.0f, 1 - u2));
+        pdf = cos_theta / pi;
+        return tangent * (radius * std::cos(phi)) + bitangent * (radius * std::sin(phi)) + normal * cos_theta;
+    }
+}
+
+glm::vec3 path_tracing_light(const Ray &ray, const Scene &scene, const RandomStream &random,
+                             const PathTracingSettings &settings, const RayDifferential &differential) {
+    auto record = scene.intersect(ray, 1e-5, std::numeric_limits<float>::infinity());
+
+    return path_tracing_shade(ray, record, scene, random, settings, differential);
+}
+
+glm::vec3 path_tracing_shade(const Ray &first_ray, const HitRecord &first_record, const Scene &scene, const RandomStream &random,
+                             const PathTracingSettings &settings, const RayDifferential &first_differential) {
+    glm::vec3 radiance {0, 0, 0};
+    glm::vec3 throughput {1, 1, 1};
+
+    Ray ray = first_ray;
+    HitRecord record = first_record;
+    RayDifferential differential = first_differential;
+
+    // the density of the direction of the last diffuse bounce and where it left from, zero for the camera ray
+    float bsdf_pdf = 0;
+    glm::vec3 bsdf_origin = ray.base;
+
+    for (int bounce = 0;; bounce++) {
+        if (bounce > 0) {
+            if (auto counters = thread_ray_counters) {
+                counters->secondary_rays++;
+            }
+            record = scene.intersect(ray, 1e-5, std::numeric_limits<float>::infinity());
+        }
+
+        if (not record.hit) {
+            radiance += throughput * scene.environment.radiance(ray.dir);
+            break;
+        }
+
+        auto point = surface_point(ray, record, scene, differential);
+
+        // an emissive triangle the previous diffuse hit may also have reached by its light sample
+        if (point.emission != glm::vec3(0)) {
+            float weight = 1;
+            if (bsdf_pdf > 0) {
+                auto index = scene.light_index(record);
+                float light_pdf = scene.light_sampler.probability(index) * scene.lights[index].pdf(bsdf_origin, point.position);
+                weight = power_heuristic(bsdf_pdf, light_pdf);
+            }
+            radiance += throughput * point.emission * weight;
+        }
+
+        if (bounce >= settings.max_bounces) {
+            break;
+        }
+
+        auto bounce_random = random.bounce(bounce);
+
+        if (bounce >= settings.min_bounces) {
+            float survival = std::min(0.95f, std::max({throughput.r, throughput.g, throughput.b}));
+            if (bounce_random.next_float() >= survival) {
+                break;
+            }
+            throughput /= survival;
+        }
+
+        // the light let through by a blended model goes on unchanged, as seen from the last diffuse hit
+        if (point.has_blending and bounce_random.next_float() >= point.alpha) {
+            ray = Ray(point.position, ray.dir);
+            differential = point.footprint;
+            continue;
+        }
+
+        // the side the ray comes from
+        auto normal = point.normal;
+        if (glm::dot(normal, normal) == 0) {
+            normal = point.geometric_normal;
+        }
+        normal = glm::normalize(normal);
+        if (glm::dot(normal, ray.dir) > 0) {
+            normal = -normal;
+        }
+
+        if (point.reflection) {
+            auto reflect = ray.dir - 2.0f * glm::dot(ray.dir, normal) * normal;
+            differential = point.footprint.reflect(ray.dir, point.normal, point.dn_dx, point.dn_dy);
+            ray = Ray(point.position, reflect);
+            bsdf_pdf = 0;
+            continue;
+        }
+
+        auto &albedo = point.object_color;
+
+        // next event estimation
+        if (not scene.lights.empty()) {
+            auto index = scene.light_sampler.sample(bounce_random.next_float());
+            auto &light = scene.lights[index];
+            float u1 = bounce_random.next_float();
+            float u2 = bounce_random.next_float();
+            auto sample = light.sample(point.position, u1, u2);
+
+            auto light_direction = glm::normalize(sample.position - point.position);
+            float cos_surface = glm::dot(normal, light_direction);
+            if (cos_surface > 0 and sample.color != glm::vec3(0)) {
+                float visibility = 1 - shadow_test(point.position, sample.position, scene);
+                float probability = scene.light_sampler.probability(index);
+
+                // the color of a triangle sample is already divided by its density
+                glm::vec3 contribution;
+                if (light.type == LightType::point) {
+                    contribution = albedo * sample.color * cos_surface;
+                } else {
+                    float weight = power_heuristic(probability * sample.pdf, cos_surface / pi);
+                    contribution = albedo / pi * sample.color * cos_surface * weight;
+                }
+                radiance += throughput * contribution * (visibility / probability);
+            }
+        }
+
+        // the cosine over pi of the Lambertian lobe cancels against the density of its sample
+        float u1 = bounce_random.next_float();
+        float u2 = bounce_random.next_float();
+        auto direction = sample_cosine(normal, u1, u2, bsdf_pdf);
+        throughput *= albedo;
+        if (throughput == glm::vec3(0) or bsdf_pdf <= 0) {
+            break;
+        }
+
+        // a diffuse bounce keeps the spread of the ray, a rough stand-in for the footprint of its lobe
+        differential = point.footprint;
+        bsdf_origin = point.position;
+        ray = Ray(point.position, direction);
+    }
+
+    return radiance;
+}
@@ -0,0 +1,80 @@
+#include "common/ray_tracing/progressive.h"
+
+ProgressiveRenderer::ProgressiveRenderer(const std::vector<std::reference_wrapper<MeshModel>> &mesh_models, int width, int height,
+                                         const RayTracingSettings &t_settings, const std::vector<Light> &lights)
+    : ProgressiveRenderer(Scene(mesh_models, lights), width, height, t_settings) {}
+
+ProgressiveRenderer::ProgressiveRenderer(Scene t_scene, int width, int height, const RayTracingSettings &t_settings)
+    : scene(std::move(t_scene)), settings(t_settings), estimate(width, height) {
+
+    // the passes report through passes(), not through the tile progress, and refine the whole image alike
+    settings.progress = {};
+    settings.adaptive.enabled = false;
+    settings.cancel = &cancel;
+}
+
+ProgressiveRenderer::~ProgressiveRenderer() {
+    stop();
+}
+
+void ProgressiveRenderer::restart(const Camera &camera) {
+    stop();
+
+    {
+        std::lock_guard lock(estimate_mutex);
+        estimate.clear();
+        pass_count = 0;
+    }
+
+    cancel = false;
+    finished = false;
+    worker = std::thread(&ProgressiveRenderer::run, this, camera);
+}
+
+void ProgressiveRenderer::stop() {
+    if (not worker.joinable()) return;
+
+    cancel = true;
+    worker.join();
+}
+
+void ProgressiveRenderer::run(Camera camera) {
+    FrameBuffer pass(estimate.width, estimate.height);
+    auto pass_settings = settings;
+
+    for (int p = 0; max_passes == 0 or p < max_passes; p++) {
+        // a different seed gives every pass its own samples
+        pass_settings.seed = settings.seed + p;
+        ray_tracing(camera, scene, pass, pass_settings);
+
+        if (cancel) break;
+
+        std::lock_guard lock(estimate_mutex);
+        for (int y = 0; y < pass.height; y++) {
+            for (int x = 0; x < pass.width; x++) {
+                estimate.accumulate(x, y, pass.color(x, y));
+            }
+        }
+        pass_count++;
+    }
+
+    finished = true;
+}
+
+int ProgressiveRenderer::passes() const {
+    std::lock_guard lock(estimate_mutex);
+    return pass_count;
+}
+
+int ProgressiveRenderer::copy_estimate(std::vector<glm::vec3> &colors) const {
+    std::lock_guard lock(estimate_mutex);
+
+    colors.resize(size_t(estimate.width) * estimate.height);
+    for (int y = 0; y < estimate.height; y++) {
+        for (int x = 0; x < estimate.width; x++) {
+            colors[estimate.pixel_index(x, y)] = estimate.color(x, y);
+        }
+    }
+
+    return pass_count;
+}
@@ -0,0 +1,131 @@
+#include "common/ray_tracing/ray_statistics.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <map>
+#include <tuple>
+
+namespace {
+    void write_counters(std::ostream &stream, const RayCounters &counters) {
+        stream << std::format("{{\"primary_rays\": {}, \"shadow_rays\": {}, \"secondary_rays\": {}, \"rays\": {}, "
+                              "\"box_tests\": {}, \"triangle_tests\": {}, \"nodes_visited\": {}, \"texture_fetches\": {}}}",
+                              counters.primary_rays, counters.shadow_rays, counters.secondary_rays, counters.rays(),
+                              counters.box_tests, counters.triangle_tests, counters.nodes_visited, counters.texture_fetches);
+    }
+
+    // black, blue, red, yellow and white at evenly spaced costs
+    glm::vec3 heat_color(float x) {
+        constexpr std::array<glm::vec3, 5> stops {glm::vec3(0, 0, 0), glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(1, 1, 0), glm::vec3(1, 1, 1)};
+
+        float position = std::clamp(x, 0.0f, 1.0f) * float(stops.size() - 1);
+        int k = std::min(int(position), int(stops.size()) - 2);
+        return glm::mix(stops[k], stops[k + 1], position - float(k));
+    }
+}
+
+RayCounters &RayCounters::operator += (const RayCounters &other) {
+    primary_rays += other.primary_rays;
+    shadow_rays += other.shadow_rays;
+    secondary_rays += other.secondary_rays;
+    box_tests += other.box_tests;
+    triangle_tests += other.triangle_tests;
+    nodes_visited += other.nodes_visited;
+    texture_fetches += other.texture_fetches;
+    return *this;
+}
+
+double RenderStatistics::mrays_per_second() const {
+    return seconds > 0 ? double(counters.rays()) / seconds * 1e-6 : 0.0;
+}
+
+void RenderStatistics::reset(int t_width, int t_height, int t_thread_count, int t_samples_per_pixel) {
+    width = t_width;
+    height = t_height;
+    thread_count = t_thread_count;
+    samples_per_pixel = t_samples_per_pixel;
+    seconds = 0;
+    counters = {};
+    thread_counters.assign(thread_count, {});
+    tiles.clear();
+}
+
+void RenderStatistics::merge() {
+    counters = {};
+    for (auto &thread: thread_counters) {
+        counters += thread;
+    }
+
+    // the rounds of adaptive sampling time a tile again, possibly on another thread, the times are summed under the first
+    std::map<std::tuple<int, int, int, int>, size_t> known;
+    std::vector<TileTiming> merged;
+    for (auto &timing: tiles) {
+        auto key = std::make_tuple(timing.tile.y_begin, timing.tile.x_begin, timing.tile.y_end, timing.tile.x_end);
+        auto [it, inserted] = known.try_emplace(key, merged.size());
+        if (inserted) {
+            merged.push_back(timing);
+        } else {
+            merged[it->second].seconds += timing.seconds;
+        }
+    }
+    tiles = std::move(merged);
+}
+
+void RenderStatistics::write_json(std::ostream &stream) const {
+    double tile_min = 0, tile_max = 0, tile_total = 0;
+    if (not tiles.empty()) {
+        auto [min, max] = std::minmax_element(tiles.begin(), tiles.end(), [](auto &a, auto &b) { return a.seconds < b.seconds; });
+        tile_min = min->seconds;
+        tile_max = max->seconds;
+        for (auto &timing: tiles) {
+            tile_total += timing.seconds;
+        }
+    }
+
+    stream << "{\n"
+           << std::format("  \"width\": {},\n  \"height\": {},\n  \"threads\": {},\n  \"samples_per_pixel\": {},\n",
+                          width, height, thread_count, samples_per_pixel)
+           << std::format("  \"seconds\": {},\n  \"mrays_per_second\": {},\n", seconds, mrays_per_second())
+           << "  \"counters\": ";
+    write_counters(stream, counters);
+
+    stream << ",\n  \"thread_counters\": [";
+    for (size_t t = 0; t < thread_counters.size(); t++) {
+        stream << (t == 0 ? "\n    " : ",\n    ");
+        write_counters(stream, thread_counters[t]);
+    }
+    stream << "\n  ],\n";
+
+    stream << std::format("  \"tile_seconds\": {{\"min\": {}, \"max\": {}, \"mean\": {}}},\n", tile_min, tile_max,
+                          tiles.empty() ? 0.0 : tile_total / double(tiles.size()))
+           << "  \"tiles\": [";
+    for (size_t k = 0; k < tiles.size(); k++) {
+        auto &timing = tiles[k];
+        stream << (k == 0 ? "\n    " : ",\n    ")
+               << std::format("{{\"x\": {}, \"y\": {}, \"width\": {}, \"height\": {}, \"thread\": {}, \"seconds\": {}}}",
+                              timing.tile.x_begin, timing.tile.y_begin, timing.tile.x_end - timing.tile.x_begin,
+                              timing.tile.y_end - timing.tile.y_begin, timing.thread_index, timing.seconds);
+    }
+    stream << "\n  ]\n}\n";
+}
+
+FrameBuffer cost_heatmap(const FrameBuffer &framebuffer) {
+    FrameBuffer heatmap(framebuffer.width, framebuffer.height);
+
+    auto cost = framebuffer.find_channel("cost");
+    if (cost == nullptr or cost->data.empty()) return heatmap;
+
+    // a few pixels interrupted by the system would otherwise darken all the others
+    std::vector<float> sorted(cost->data.begin(), cost->data.end());
+    auto percentile = sorted.begin() + std::ptrdiff_t(double(sorted.size() - 1) * 0.99);
+    std::nth_element(sorted.begin(), percentile, sorted.end());
+    float max_cost = *percentile;
+
+    for (int y = 0; y < framebuffer.height; y++) {
+        for (int x = 0; x < framebuffer.width; x++) {
+            float value = cost->data[framebuffer.pixel_index(x, y)];
+            heatmap.set_color(x, y, heat_color(max_cost > 0 ? value / max_cost : 0.0f));
+        }
+    }
+    return heatmap;
+}
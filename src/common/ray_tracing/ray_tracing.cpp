@@ -1,2 +1,614 @@
-#include "common/ray_tracing/ray.h"
+#include "common/ray_tracing/ray_tracing.h"
+#include "common/ray_tracing/wavefront.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <tuple>
+
+namespace {
+    /*
+     * the points of the lights seen from point for its shadow rays, the weight of every sample in the estimate is
+     * folded into its color, returns the number of samples
+     */
+    int sample_lights(const Scene &scene, glm::vec3 point, RandomStream &random, std::array<LightSample, MAX_LIGHT_SAMPLES> &samples) {
+        auto &lights = scene.lights;
+        int count = std::clamp(scene.light_samples, 1, MAX_LIGHT_SAMPLES);
+
+        if (lights.size() <= size_t(count)) {
+            for (size_t i = 0; i < lights.size(); i++) {
+                // a point light draws no random numbers, so the stream is only used by scenes with emissive models
+                bool point_light = lights[i].type == LightType::point;
+                float u1 = point_light ? 0 : random.next_float();
+                float u2 = point_light ? 0 : random.next_float();
+                samples[i] = lights[i].sample(point, u1, u2);
+            }
+            return int(lights.size());
+        }
+
+        // the picks share one random offset in their strata of [0, 1)
+        float offset = random.next_float();
+        for (int k = 0; k < count; k++) {
+            auto i = scene.light_sampler.sample((float(k) + offset) / float(count));
+            float u1 = random.next_float();
+            float u2 = random.next_float();
+            samples[k] = lights[i].sample(point, u1, u2);
+            samples[k].color /= scene.light_sampler.probability(i) * float(count);
+        }
+        return count;
+    }
+}
+
+bool ray_tracing_box_test (const Ray &ray, const AxisAlignedBoundingBox &box) {
+    return not box.ray_intersection(ray.base, ray.inv_dir, 0, std::numeric_limits<float>::infinity()).is_empty();
+}
+
+float shadow_test(glm::vec3 pos, glm::vec3 light_src, const Scene &scene) {
+    constexpr float eps = 1e-4;
+
+    auto to_light = light_src - pos;
+    float distance = glm::length(to_light);
+
+    Ray ray(pos, to_light / distance);
+
+    if (auto counters = thread_ray_counters) {
+        counters->shadow_rays++;
+    }
+
+    // a point on an emissive model would otherwise be shadowed by its own triangle
+    return scene.occlusion(ray, eps, distance * (1 - eps));
+}
+
+/*
+ * Whitted style radiance along a ray, the random stream belongs to this bounce of the path
+ * and the streams of the following bounces are derived from it
+ */
+glm::vec3 ray_tracing_light(glm::vec3 origin, glm::vec3 direction, int depth, glm::vec3 light_color, const Scene &scene, const RandomStream &random,
+                            float throughput, const RayDifferential &differential) {
+    if (depth > MAX_RAY_TRACING_DEPTH or throughput < MIN_RAY_TRACING_THROUGHPUT) {
+        return {0, 0, 0};
+    }
+
+    if (auto counters = thread_ray_counters) {
+        counters->secondary_rays++;
+    }
+
+    Ray ray(origin, direction);
+
+    auto record = scene.intersect(ray, 1e-5, std::numeric_limits<float>::infinity());
+
+    return ray_tracing_shade(ray, record, depth, light_color, scene, random, throughput, differential);
+}
+
+SurfacePoint surface_point(const Ray &ray, const HitRecord &record, const Scene &scene, const RayDifferential &differential) {
+    auto direction = ray.dir;
+
+    SurfacePoint point;
+
+    float t = record.t, u = record.u, v = record.v, w = record.w;
+
+    MeshModel &model = scene.model(record);
+    auto &tri = scene.triangle(record);
+    auto &v0 = model.vertices[tri.x];
+    auto &v1 = model.vertices[tri.y];
+    auto &v2 = model.vertices[tri.z];
+
+    auto uv = v0.texture_coord * u + v1.texture_coord * v + v2.texture_coord * w;
+
+    // the footprint of the ray on the plane of the triangle, in world space
+    auto &instance = scene.instance(record);
+    auto edge1 = v1.point - v0.point;
+    auto edge2 = v2.point - v0.point;
+    if (not instance.identity) {
+        edge1 = glm::mat3(instance.object_to_world) * edge1;
+        edge2 = glm::mat3(instance.object_to_world) * edge2;
+    }
+    auto plane_normal = glm::cross(edge1, edge2);
+    auto &footprint = point.footprint;
+    footprint = differential.transfer(direction, t, plane_normal);
+    point.geometric_normal = plane_normal;
+
+    // the change of the barycentric weights v and w across the footprint, by the dual basis of the edges
+    float area_squared = glm::dot(plane_normal, plane_normal);
+    float inv_area_squared = area_squared > 0 ? 1.0f / area_squared : 0.0f;
+    auto dual1 = glm::cross(edge2, plane_normal) * inv_area_squared;
+    auto dual2 = glm::cross(plane_normal, edge1) * inv_area_squared;
+    glm::vec2 dv {glm::dot(dual1, footprint.dp_dx), glm::dot(dual1, footprint.dp_dy)};
+    glm::vec2 dw {glm::dot(dual2, footprint.dp_dx), glm::dot(dual2, footprint.dp_dy)};
+
+    auto duv_dx = (v1.texture_coord - v0.texture_coord) * dv.x + (v2.texture_coord - v0.texture_coord) * dw.x;
+    auto duv_dy = (v1.texture_coord - v0.texture_coord) * dv.y + (v2.texture_coord - v0.texture_coord) * dw.y;
+
+    auto sample_texture = [&](size_t k) {
+        auto &texture = scene.texture(record, k);
+        return texture.sample(uv, scene.texture_filter, texture.lod(duv_dx, duv_dy));
+    };
+
+    if (model.textures.empty()) {
+        point.object_color = model.object_color;
+    } else {
+        glm::vec3 diffuse_texture {0, 0, 0};
+        for (size_t k = 0; k < model.textures.size(); k++) {
+            auto type = model.textures[k].type;
+            if (type == TextureType::diffuse_texture) {
+                diffuse_texture = sample_texture(k);
+            }
+            if (type == TextureType::specular_texture) {
+                point.specular_texture = sample_texture(k);
+                point.has_specular_texture = true;
+            }
+        }
+        point.object_color = diffuse_texture;
+
+        if (model.blending) {
+            auto blending_texture = sample_texture(0);
+            point.alpha = blending_texture.a;
+
+            if (point.alpha < 0.9) {
+                point.has_blending = true ;
+            }
+        }
+    }
+
+    auto normal = v0.normal * u + v1.normal * v + v2.normal * w;
+
+    // the change of the normal across the footprint, interpolated like the texture coordinates
+    auto dn_dx = (v1.normal - v0.normal) * dv.x + (v2.normal - v0.normal) * dw.x;
+    auto dn_dy = (v1.normal - v0.normal) * dv.y + (v2.normal - v0.normal) * dw.y;
+
+    // the normals are stored in object space, only their direction is transformed
+    if (not instance.identity) {
+        auto world_normal = instance.normal_to_world * normal;
+        float scale = glm::length(normal) / glm::length(world_normal);
+        normal = world_normal * scale;
+        dn_dx = instance.normal_to_world * dn_dx * scale;
+        dn_dy = instance.normal_to_world * dn_dy * scale;
+    }
+
+    point.normal = normal;
+    point.dn_dx = dn_dx;
+    point.dn_dy = dn_dy;
+    point.position = ray.at(t);
+    point.emission = model.emission;
+    point.reflection = model.reflection;
+
+    return point;
+}
+
+AuxiliarySample auxiliary_sample(const Ray &ray, const HitRecord &record, const Scene &scene, const RayDifferential &differential) {
+    AuxiliarySample sample;
+    if (not record.hit) {
+        return sample;
+    }
+
+    auto point = surface_point(ray, record, scene, differential);
+
+    sample.albedo = point.object_color;
+    if (point.reflection) {
+        sample.albedo = {1, 1, 1};
+    } else if (point.has_blending) {
+        sample.albedo = glm::mix(glm::vec3(1), point.object_color, point.alpha);
+    }
+
+    auto normal = point.normal;
+    if (glm::dot(normal, normal) == 0) {
+        normal = point.geometric_normal;
+    }
+    if (glm::dot(normal, normal) > 0) {
+        normal = glm::normalize(normal);
+        sample.normal = glm::dot(normal, ray.dir) > 0 ? -normal : normal;
+    }
+
+    sample.depth = glm::length(point.position - ray.base);
+    return sample;
+}
+
+SurfaceInteraction ray_tracing_surface(const Ray &ray, const HitRecord &record, int depth, glm::vec3 light_color, const Scene &scene,
+                                       const RandomStream &random, const RayDifferential &differential) {
+    auto origin = ray.base;
+    auto direction = ray.dir;
+
+    SurfaceInteraction surface;
+
+    auto point = surface_point(ray, record, scene, differential);
+    auto &object_color = point.object_color;
+    auto &normal = point.normal;
+    auto &footprint = point.footprint;
+    float alpha = point.alpha;
+
+    constexpr float ambient_strength = 0.2;
+
+    // compute local ambient
+    auto ambient = ambient_strength * light_color;
+
+    auto frag_position = point.position;
+    auto view_direction = glm::normalize(origin - frag_position);
+
+    surface.position = frag_position;
+    surface.unshadowed = point.emission * light_color;
+
+    auto light_random = random;
+    std::array<LightSample, MAX_LIGHT_SAMPLES> light_samples;
+    surface.light_count = sample_lights(scene, frag_position, light_random, light_samples);
+
+    for (int k = 0; k < surface.light_count; k++) {
+        auto &light = light_samples[k];
+        surface.light_positions[k] = light.position;
+
+        // compute refraction lighting strength
+        if (point.has_blending) {
+            surface.shadowed[k] = alpha * object_color * light_color * light.color;
+            continue;
+        }
+
+        // compute local diffuse
+        auto light_direction = glm::normalize(light.position - frag_position);
+        float diffuse_strength = std::max(0.0f, glm::dot(normal, light_direction));
+        auto diffuse = diffuse_strength * light_color;
+
+        // compute local specular
+        constexpr const float specular_strength = 0.5;
+        constexpr const int specular_pow = 32;
+        auto reflect_direction = glm::reflect(-light_direction, normal);
+        float specular_coefficient = std::pow(std::max(0.0f, glm::dot(view_direction, reflect_direction)), specular_pow);
+        auto specular = specular_strength * specular_coefficient * light_color;
+
+        if (point.has_specular_texture) {
+            specular = specular * point.specular_texture;
+        }
+
+        surface.shadowed[k] = (diffuse + specular) * object_color * light.color;
+    }
+
+    if (point.has_blending) {
+        surface.continuation = Ray(frag_position, direction);
+        surface.continuation_weight = 1 - alpha;
+        surface.continuation_depth = depth + 1;
+        surface.continuation_light_color = light_color;
+        surface.continuation_differential = footprint;
+        return surface;
+    }
+
+    surface.unshadowed += ambient * object_color;
+
+    // compute the mirror reflection
+    auto reflect = direction - 2.0f * glm::dot(direction, normal) * normal;
+    surface.continuation = Ray(frag_position, reflect);
+    surface.continuation_differential = footprint.reflect(direction, normal, point.dn_dx, point.dn_dy);
+
+    if (point.reflection) {
+        surface.continuation_weight = 1;
+        surface.continuation_depth = depth + 1;
+        surface.continuation_light_color = light_color;
+        return surface;
+    }
+
+    // the faint reflection of a plain surface does not count as a bounce and is lit by the surface colour
+    surface.continuation_weight = 0.1f;
+    surface.continuation_depth = depth;
+    surface.continuation_light_color = object_color;
+    return surface;
+}
+
+glm::vec3 ray_tracing_shade(const Ray &ray, const HitRecord &record, int depth, glm::vec3 light_color, const Scene &scene, const RandomStream &random,
+                            float throughput, const RayDifferential &differential) {
+    if (not record.hit) {
+        return scene.environment.radiance(ray.dir) * light_color;
+    }
+
+    auto surface = ray_tracing_surface(ray, record, depth, light_color, scene, random, differential);
+
+    auto local = surface.unshadowed;
+    for (int k = 0; k < surface.light_count; k++) {
+        float shadow = shadow_test(surface.position, surface.light_positions[k], scene);
+        local += (1.0f - shadow) * surface.shadowed[k];
+    }
+
+    auto &next = surface.continuation;
+    auto next_depth = surface.continuation_depth;
+    auto next_weight = surface.continuation_weight;
+    return local + next_weight * ray_tracing_light(next.base, next.dir, next_depth, surface.continuation_light_color, scene,
+                                                   random.bounce(next_depth), throughput * next_weight, surface.continuation_differential);
+}
+
+ImagePlane image_plane(const Camera &camera, int width, int height) {
+    auto up = camera.camera_up_axis;
+    auto right = camera.camera_right_axis;
+
+    float aspect = float(width) / float(height);
+
+    ImagePlane plane;
+    plane.base = camera.position + camera.camera_front * 0.1f + up * 0.0414f - right * 0.0414f * aspect;
+    plane.up = up * 0.0414f / (float(height) / 2);
+    plane.right = right * 0.0414f * aspect / (float(width) / 2);
+    return plane;
+}
+
+void ray_tracing(const Camera &camera, const std::vector<std::reference_wrapper<MeshModel>> &mesh_models, FrameBuffer &framebuffer, const RayTracingSettings &settings) {
+    // the acceleration structure is built once per render, the models are left as they are
+    Scene scene(mesh_models);
+
+    ray_tracing(camera, scene, framebuffer, settings);
+}
+
+void ray_tracing(const Camera &camera, const Scene &scene, FrameBuffer &framebuffer, const RayTracingSettings &settings) {
+
+    int n = framebuffer.height;
+    int m = framebuffer.width;
+
+    auto plane = image_plane(camera, m, n);
+    auto base = plane.base;
+    auto up = plane.up;
+    auto right = plane.right;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    auto seconds_since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    // the seconds spent on every pixel are summed into the channel "cost", the tiles of every thread are timed apart
+    auto statistics = settings.statistics;
+    FrameBufferChannel *cost = nullptr;
+    std::vector<std::vector<TileTiming>> thread_tiles;
+    if (statistics) {
+        int thread_count = TileScheduler::resolve_thread_count(settings.thread_count);
+        statistics->reset(m, n, thread_count, settings.samples_per_pixel);
+        thread_tiles.resize(thread_count);
+
+        cost = framebuffer.find_channel("cost");
+        if (cost == nullptr) {
+            cost = &framebuffer.add_channel("cost", 1);
+        }
+    }
+
+    // the pixels are only timed for the channel "cost", without statistics the clock is not read for them
+    auto cost_start = [&]() {
+        return cost ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point {};
+    };
+
+    framebuffer.clear();
+
+    TileScheduler scheduler(m, n, settings.tile_size, settings.tile_order);
+
+    // the pixels sampled by the current round, all of them while it is null
+    const std::vector<unsigned char> *active = nullptr;
+
+    auto is_active = [&](int i, int j) {
+        return active == nullptr or (*active)[framebuffer.pixel_index(j, i)];
+    };
+
+    /*
+     * all the primary rays leave the camera position towards the image plane, their directions differ by right
+     * from one column to the next and by -up from one row to the next, the samples of a pixel share its footprint
+     */
+    float footprint_scale = std::max(0.125f, 1.0f / std::sqrt(float(std::max(1, settings.samples_per_pixel))));
+    RayDifferential primary_differential;
+    primary_differential.dd_dx = right * footprint_scale;
+    primary_differential.dd_dy = -up * footprint_scale;
+
+    // the jittered primary ray of sample k of pixel (i, j) and its differentials, the stream continues at the first bounce
+    auto primary_ray = [&](int i, int j, int k) {
+        if (auto counters = thread_ray_counters) {
+            counters->primary_rays++;
+        }
+
+        RandomStream random(i * m + j, k, settings.seed);
+        auto view_point = base - (up * float(i)) + (right * (float(j)));
+        auto delta_i = random.next_float();
+        auto delta_j = random.next_float();
+        view_point += (-up * delta_i + right * delta_j);
+        return std::make_tuple(Ray(camera.position, view_point - camera.position), primary_differential, random.bounce(1));
+    };
+
+    // the first hits are only shaded a second time for the auxiliary channels when the framebuffer has them
+    bool auxiliary = framebuffer.has_auxiliary_channels();
+
+    // the same sample of up to RAY_PACKET_SIZE neighbouring active pixels of a row share a packet
+    auto render_tile_packets = [&](const Tile &tile, int sample_count) {
+        std::array<HitRecord, RAY_PACKET_SIZE> records;
+        std::array<Ray, RAY_PACKET_SIZE> rays;
+        std::array<RayDifferential, RAY_PACKET_SIZE> differentials;
+        std::array<RandomStream, RAY_PACKET_SIZE> randoms;
+
+        // the active columns of the row and the index of their first sample of this round
+        std::vector<int> columns, first_samples;
+
+        for (int i = tile.y_begin; i < tile.y_end; i++) {
+            columns.clear();
+            first_samples.clear();
+            for (int j = tile.x_begin; j < tile.x_end; j++) {
+                if (is_active(i, j)) {
+                    columns.push_back(j);
+                    first_samples.push_back(int(framebuffer.sample_count(j, i)));
+                }
+            }
+
+            int column_count = int(columns.size());
+            for (int k = 0; k < sample_count; k++) {
+                for (int c_begin = 0; c_begin < column_count; c_begin += RAY_PACKET_SIZE) {
+                    int lanes = std::min(RAY_PACKET_SIZE, column_count - c_begin);
+                    auto packet_start = cost_start();
+
+                    RayPacket packet;
+                    for (int lane = 0; lane < lanes; lane++) {
+                        std::tie(rays[lane], differentials[lane], randoms[lane]) = primary_ray(i, columns[c_begin + lane], first_samples[c_begin + lane] + k);
+                        packet.set(lane, rays[lane], std::numeric_limits<float>::infinity());
+                    }
+
+                    scene.intersect(packet, 1e-5, records);
+
+                    for (int lane = 0; lane < lanes; lane++) {
+                        if (settings.integrator == RayTracingIntegrator::path) {
+                            framebuffer.accumulate(columns[c_begin + lane], i, path_tracing_shade(rays[lane], records[lane], scene, randoms[lane],
+                                                                                                  settings.path, differentials[lane]));
+                        } else {
+                            framebuffer.accumulate(columns[c_begin + lane], i, ray_tracing_shade(rays[lane], records[lane], 1, {1, 1, 1}, scene,
+                                                                                                       randoms[lane], 1, differentials[lane]));
+                        }
+                        if (auxiliary) {
+                            framebuffer.accumulate(columns[c_begin + lane], i, auxiliary_sample(rays[lane], records[lane], scene, differentials[lane]));
+                        }
+                    }
+
+                    // the lanes share the time of the packet, they are not timed apart
+                    if (cost) {
+                        float lane_seconds = float(seconds_since(packet_start) / lanes);
+                        for (int lane = 0; lane < lanes; lane++) {
+                            cost->data[framebuffer.pixel_index(columns[c_begin + lane], i)] += lane_seconds;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<WavefrontIntegrator> wavefront_integrators;
+    if (settings.integrator == RayTracingIntegrator::wavefront) {
+        int thread_count = TileScheduler::resolve_thread_count(settings.thread_count);
+        wavefront_integrators.reserve(thread_count);
+        for (int t = 0; t < thread_count; t++) {
+            wavefront_integrators.emplace_back(scene);
+        }
+    }
+
+    auto cancelled = [&]() {
+        return settings.cancel and settings.cancel->load(std::memory_order_relaxed);
+    };
+
+    auto render_tile = [&](const Tile &tile, int thread_index, int sample_count) {
+        if (settings.integrator == RayTracingIntegrator::wavefront) {
+            auto tile_start = cost_start();
+            wavefront_integrators[thread_index].render_tile(tile, sample_count, primary_ray, framebuffer, active);
+
+            // the bounces of all the pixels of the tile are interleaved, they share the time of the tile
+            if (cost) {
+                int active_count = 0;
+                for (int i = tile.y_begin; i < tile.y_end; i++) {
+                    for (int j = tile.x_begin; j < tile.x_end; j++) {
+                        active_count += is_active(i, j);
+                    }
+                }
+
+                float pixel_seconds = float(seconds_since(tile_start) / std::max(1, active_count));
+                for (int i = tile.y_begin; i < tile.y_end; i++) {
+                    for (int j = tile.x_begin; j < tile.x_end; j++) {
+                        if (is_active(i, j)) cost->data[framebuffer.pixel_index(j, i)] += pixel_seconds;
+                    }
+                }
+            }
+            return;
+        }
+
+        if (settings.packet_tracing) {
+            render_tile_packets(tile, sample_count);
+            return;
+        }
+
+        for (int i = tile.y_begin; i < tile.y_end; i++) {
+            for (int j = tile.x_begin; j < tile.x_end; j++) {
+                if (not is_active(i, j)) continue;
+
+                auto pixel_start = cost_start();
+                int first_sample = int(framebuffer.sample_count(j, i));
+                for (int k = first_sample; k < first_sample + sample_count; k++) {
+                    auto [ray, differential, random] = primary_ray(i, j, k);
+                    auto record = scene.intersect(ray, 1e-5, std::numeric_limits<float>::infinity());
+                    if (settings.integrator == RayTracingIntegrator::path) {
+                        framebuffer.accumulate(j, i, path_tracing_shade(ray, record, scene, random, settings.path, differential));
+                    } else {
+                        framebuffer.accumulate(j, i, ray_tracing_shade(ray, record, 1, {1, 1, 1}, scene, random, 1, differential));
+                    }
+                    if (auxiliary) {
+                        framebuffer.accumulate(j, i, auxiliary_sample(ray, record, scene, differential));
+                    }
+                }
+
+                if (cost) {
+                    cost->data[framebuffer.pixel_index(j, i)] += float(seconds_since(pixel_start));
+                }
+            }
+        }
+    };
+
+    // the progress adds up over the rounds of adaptive sampling, each round adding its tiles to the total
+    int previous_tiles = 0;
+    std::function<void(int, int)> progress;
+    if (settings.progress) {
+        progress = [&](int finished, int total) {
+            settings.progress(previous_tiles + finished, previous_tiles + total);
+        };
+    }
+
+    // sample_count more samples of every active pixel, the sample indices go on from the samples taken so far
+    auto render_round = [&](int sample_count) {
+        scheduler.run(settings.thread_count, [&](const Tile &tile, int thread_index) {
+            if (cancelled()) {
+                return;
+            }
+
+            if (statistics == nullptr) {
+                render_tile(tile, thread_index, sample_count);
+                return;
+            }
+
+            // the thread counts into its own counters, nothing is shared until the render is over
+            auto tile_start = std::chrono::steady_clock::now();
+            thread_ray_counters = &statistics->thread_counters[thread_index];
+            render_tile(tile, thread_index, sample_count);
+            thread_ray_counters = nullptr;
+            thread_tiles[thread_index].push_back({tile, thread_index, seconds_since(tile_start)});
+        }, progress);
+
+        previous_tiles += int(scheduler.get_tiles().size());
+    };
+
+    auto finish_statistics = [&]() {
+        if (statistics == nullptr) return;
+
+        statistics->seconds = seconds_since(start_time);
+        for (auto &tiles: thread_tiles) {
+            statistics->tiles.insert(statistics->tiles.end(), tiles.begin(), tiles.end());
+        }
+        statistics->merge();
+    };
+
+    render_round(settings.samples_per_pixel);
+
+    auto &adaptive = settings.adaptive;
+    if (not adaptive.enabled or adaptive.batch_samples <= 0) {
+        finish_statistics();
+        return;
+    }
+
+    std::vector<unsigned char> noisy(size_t(m) * n);
+    active = &noisy;
+
+    while (not cancelled()) {
+        if (adaptive.time_budget > 0 and seconds_since(start_time) >= adaptive.time_budget) {
+            break;
+        }
+
+        size_t noisy_count = 0;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < m; j++) {
+                bool below_max = framebuffer.sample_count(j, i) + adaptive.batch_samples <= adaptive.max_samples_per_pixel;
+                float tolerance = adaptive.error_threshold * (framebuffer.mean_luminance(j, i) + adaptive.error_floor);
+
+                bool is_noisy = below_max and framebuffer.standard_error(j, i) > tolerance;
+                noisy[framebuffer.pixel_index(j, i)] = is_noisy;
+                noisy_count += is_noisy;
+            }
+        }
+
+        if (noisy_count == 0) {
+            break;
+        }
+
+        render_round(adaptive.batch_samples);
+    }
+
+    finish_statistics();
+}
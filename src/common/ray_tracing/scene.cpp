@@ -0,0 +1,586 @@
+#include "common/ray_tracing/scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+    template<typename T>
+    void hash_combine(size_t &seed, const T &value) {
+        seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    // hash of everything the acceleration structure of a model is built from
+    size_t mesh_hash(const MeshModel &model) {
+        size_t seed = 0;
+        hash_combine(seed, model.vertices.size());
+        hash_combine(seed, model.faces_indices.size());
+        hash_combine(seed, model.blending);
+
+        for (auto &vertex: model.vertices) {
+            hash_combine(seed, vertex.point.x);
+            hash_combine(seed, vertex.point.y);
+            hash_combine(seed, vertex.point.z);
+            hash_combine(seed, vertex.texture_coord.x);
+            hash_combine(seed, vertex.texture_coord.y);
+        }
+
+        for (auto &tri: model.faces_indices) {
+            hash_combine(seed, tri.x);
+            hash_combine(seed, tri.y);
+            hash_combine(seed, tri.z);
+        }
+
+        return seed;
+    }
+
+    // the normals and the colours are read from the model itself when shading, they need not match
+    bool same_mesh(const MeshModel &a, const MeshModel &b) {
+        if (a.vertices.size() != b.vertices.size() or a.faces_indices.size() != b.faces_indices.size()) return false;
+        if (a.blending != b.blending) return false;
+
+        // the opacity of the triangles comes from the alpha of the first texture
+        if (a.blending) {
+            if (a.textures.empty() != b.textures.empty()) return false;
+            if (not a.textures.empty() and a.textures[0].data != b.textures[0].data) return false;
+        }
+
+        for (size_t i = 0; i < a.vertices.size(); i++) {
+            if (a.vertices[i].point != b.vertices[i].point or a.vertices[i].texture_coord != b.vertices[i].texture_coord) {
+                return false;
+            }
+        }
+
+        for (size_t f = 0; f < a.faces_indices.size(); f++) {
+            auto &ta = a.faces_indices[f];
+            auto &tb = b.faces_indices[f];
+            if (ta.x != tb.x or ta.y != tb.y or ta.z != tb.z) return false;
+        }
+
+        return true;
+    }
+
+    AxisAlignedBoundingBox transform_box(const glm::mat4 &transform, const AxisAlignedBoundingBox &box) {
+        AxisAlignedBoundingBox result;
+        for (int i = 0; i <= 1; i++) {
+            for (int j = 0; j <= 1; j++) {
+                for (int k = 0; k <= 1; k++) {
+                    glm::vec3 corner {i ? box.x_range.end : box.x_range.start,
+                                      j ? box.y_range.end : box.y_range.start,
+                                      k ? box.z_range.end : box.z_range.start};
+                    result.expand(glm::vec3(transform * glm::vec4(corner, 1.0f)));
+                }
+            }
+        }
+        return result;
+    }
+}
+
+Scene::Scene(const std::vector<std::reference_wrapper<MeshModel>> &t_mesh_models, const std::vector<Light> &t_point_lights)
+    : mesh_models(t_mesh_models), point_lights(t_point_lights) {
+    build();
+}
+
+void Scene::build() {
+    build_meshes();
+    build_textures();
+
+    for (auto &mesh: meshes) {
+        classify_opacity(mesh);
+    }
+
+    build_top_level();
+    build_lights();
+}
+
+void Scene::build_meshes() {
+    meshes.clear();
+    instances.clear();
+
+    // the meshes built so far by the hash of their source model
+    std::unordered_map<size_t, std::vector<unsigned int>> known_meshes;
+
+    for (unsigned int k = 0; k < mesh_models.size(); k++) {
+        auto &model = mesh_models[k].get();
+
+        SceneInstance instance;
+        auto &candidates = known_meshes[mesh_hash(model)];
+        auto shared = std::find_if(candidates.begin(), candidates.end(), [&](unsigned int m) {
+            return same_mesh(mesh_models[meshes[m].source_model].get(), model);
+        });
+
+        if (shared != candidates.end()) {
+            instance.mesh = *shared;
+        } else {
+            instance.mesh = meshes.size();
+            candidates.push_back(instance.mesh);
+
+            auto &mesh = meshes.emplace_back();
+            mesh.source_model = k;
+            build_mesh(mesh);
+        }
+
+        instances.push_back(instance);
+        place_instance(k);
+    }
+}
+
+void Scene::build_mesh(SceneMesh &mesh) {
+    mesh.bvh.build({mesh_models[mesh.source_model]});
+    mesh.wide_bvh.build(mesh.bvh);
+    mesh.built_cost = BVH::sah_cost(mesh.bvh.nodes);
+}
+
+void Scene::place_instance(unsigned int k) {
+    auto &transform = mesh_models[k].get().transform;
+    auto &instance = instances[k];
+
+    instance.object_to_world = transform;
+    instance.world_to_object = glm::inverse(transform);
+    instance.normal_to_world = glm::transpose(glm::inverse(glm::mat3(transform)));
+    instance.identity = transform == glm::mat4(1.0f);
+
+    auto &mesh = meshes[instance.mesh];
+    instance.world_box = mesh.bvh.nodes.empty() ? AxisAlignedBoundingBox() : transform_box(transform, mesh.bvh.nodes[0].box);
+}
+
+void Scene::build_top_level() {
+    top_nodes.clear();
+    instance_order.clear();
+
+    std::vector<BVH::BuildItem> items;
+    for (unsigned int k = 0; k < instances.size(); k++) {
+        // a model without triangles is never hit
+        if (meshes[instances[k].mesh].bvh.nodes.empty()) continue;
+
+        auto &box = instances[k].world_box;
+        items.push_back({box, box.center(), k});
+    }
+
+    if (items.empty()) return;
+
+    top_nodes.reserve(2 * items.size());
+    BVH::build_node(top_nodes, items, 0, items.size(), 0);
+
+    instance_order.reserve(items.size());
+    for (auto &item: items) {
+        instance_order.push_back(item.primitive);
+    }
+
+    top_built_cost = BVH::sah_cost(top_nodes);
+}
+
+bool Scene::refit(const std::vector<unsigned int> &deformed_models) {
+    // the models added since the last build have no instance yet
+    if (instances.size() != mesh_models.size()) {
+        build();
+        return true;
+    }
+
+    std::vector<unsigned int> users(meshes.size(), 0);
+    for (auto &instance: instances) {
+        users[instance.mesh]++;
+    }
+
+    bool rebuilt = false;
+
+    for (auto k: deformed_models) {
+        auto &model = mesh_models[k].get();
+        auto &mesh = meshes[instances[k].mesh];
+
+        // the other models of a shared mesh keep their vertices, the meshes have to be matched again
+        if (users[instances[k].mesh] > 1 or model.faces_indices.size() != mesh.bvh.primitives.size()) {
+            build();
+            return true;
+        }
+
+        mesh.bvh.refit({model});
+        if (BVH::sah_cost(mesh.bvh.nodes) > rebuild_cost_ratio * mesh.built_cost) {
+            // the rebuild orders the primitives anew, their opacities have to follow
+            build_mesh(mesh);
+            classify_opacity(mesh);
+            rebuilt = true;
+        } else {
+            // collapsing is linear in the nodes, no split is searched
+            mesh.wide_bvh.build(mesh.bvh);
+        }
+    }
+
+    for (unsigned int k = 0; k < instances.size(); k++) {
+        place_instance(k);
+    }
+
+    BVH::refit_nodes(top_nodes, [&](const BVHNode &leaf) {
+        AxisAlignedBoundingBox box;
+        for (auto i = leaf.offset; i < leaf.offset + leaf.count; i++) {
+            box.expand(instances[instance_order[i]].world_box);
+        }
+        return box;
+    });
+
+    if (BVH::sah_cost(top_nodes) > rebuild_cost_ratio * top_built_cost) {
+        build_top_level();
+        rebuilt = true;
+    }
+
+    // the emissive models may have moved with the others
+    build_lights();
+
+    return rebuilt;
+}
+
+void Scene::build_lights() {
+    lights = point_lights;
+    first_lights.assign(mesh_models.size(), 0);
+
+    for (unsigned int k = 0; k < mesh_models.size(); k++) {
+        auto &model = mesh_models[k].get();
+        if (model.emission == glm::vec3(0)) continue;
+
+        first_lights[k] = lights.size();
+
+        auto &object_to_world = instances[k].object_to_world;
+        auto world = [&](unsigned int v) {
+            return glm::vec3(object_to_world * glm::vec4(model.vertices[v].point, 1));
+        };
+
+        for (auto &face: model.faces_indices) {
+            Light light;
+            light.type = LightType::triangle;
+            light.position = world(face.x);
+            light.edge1 = world(face.y) - light.position;
+            light.edge2 = world(face.z) - light.position;
+            light.color = model.emission;
+
+            // a degenerate triangle has no power and is never picked, it keeps the light of a face at its index
+            lights.push_back(light);
+        }
+    }
+
+    light_sampler.build(lights);
+}
+
+void Scene::build_textures() {
+    textures.clear();
+
+    // the textures converted so far by the image they were read from
+    std::unordered_map<const unsigned char*, unsigned int> known_textures;
+
+    for (unsigned int k = 0; k < mesh_models.size(); k++) {
+        auto &instance = instances[k];
+        instance.textures.clear();
+
+        for (auto &texture: mesh_models[k].get().textures) {
+            auto [known, inserted] = known_textures.try_emplace(texture.data, textures.size());
+            if (inserted) {
+                textures.emplace_back(texture);
+            }
+            instance.textures.push_back(known->second);
+        }
+    }
+}
+
+void Scene::classify_opacity(SceneMesh &mesh) {
+    auto &model = mesh_models[mesh.source_model].get();
+    auto &opacity = mesh.opacity;
+
+    opacity.assign(mesh.bvh.primitives.size(), TriangleOpacity::opaque);
+    if (not model.blending) return;
+
+    // the alpha comes from the first texture, as in the shading, without an alpha channel it is opaque
+    if (model.textures.empty() or model.textures[0].num_channels != 4) return;
+    auto &texture = textures[instances[mesh.source_model].textures[0]];
+    if (texture.empty()) return;
+
+    for (size_t i = 0; i < mesh.bvh.primitives.size(); i++) {
+        auto &primitive = mesh.bvh.primitives[i];
+
+        auto &tri = model.faces_indices[primitive.face_index];
+        auto uv0 = model.vertices[tri.x].texture_coord;
+        auto uv1 = model.vertices[tri.y].texture_coord;
+        auto uv2 = model.vertices[tri.z].texture_coord;
+
+        auto uv_min = glm::min(uv0, glm::min(uv1, uv2));
+        auto uv_max = glm::max(uv0, glm::max(uv1, uv2));
+
+        // texels read by a nearest or bilinear lookup anywhere in the uv bounding box of the triangle,
+        // a footprint wider than the texture reads all of it
+        int width = texture.width(), height = texture.height();
+        int i_begin = int(std::floor(uv_min.x * width - 0.5f));
+        int i_end = int(std::floor(uv_max.x * width - 0.5f)) + 1;
+        int j_begin = int(std::floor(uv_min.y * height - 0.5f));
+        int j_end = int(std::floor(uv_max.y * height - 0.5f)) + 1;
+        if (i_end - i_begin >= width) {
+            i_begin = 0;
+            i_end = width - 1;
+        }
+        if (j_end - j_begin >= height) {
+            j_begin = 0;
+            j_end = height - 1;
+        }
+
+        float alpha_min = 1, alpha_max = 0;
+        for (int j = j_begin; j <= j_end; j++) {
+            for (int k = i_begin; k <= i_end; k++) {
+                auto alpha = texture.texel(0, k, j).a;
+                alpha_min = std::min(alpha_min, alpha);
+                alpha_max = std::max(alpha_max, alpha);
+            }
+        }
+
+        if (alpha_min == 1) {
+            opacity[i] = TriangleOpacity::opaque;
+        } else if (alpha_max == 0) {
+            opacity[i] = TriangleOpacity::transparent;
+        } else {
+            opacity[i] = TriangleOpacity::alpha_test;
+        }
+    }
+}
+
+Ray Scene::to_object(const SceneInstance &instance, const Ray &ray) const {
+    auto &m = instance.world_to_object;
+    return Ray(glm::vec3(m * glm::vec4(ray.base, 1.0f)), glm::mat3(m) * ray.dir);
+}
+
+HitRecord Scene::intersect(const Ray &ray, float t_min, float t_max) const {
+    HitRecord record;
+    if (top_nodes.empty()) return record;
+
+    TraversalCounts counts;
+    counts.box_tests++;
+
+    // pending nodes together with the distance at which the ray enters them
+    std::array<std::pair<unsigned int, float>, BVH::max_depth> stack;
+    int stack_size = 0;
+
+    auto root_range = top_nodes[0].box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max);
+    if (not root_range.is_empty()) {
+        stack[stack_size++] = {0, root_range.start};
+    }
+
+    while (stack_size > 0) {
+        auto [node_index, entry] = stack[--stack_size];
+        if (entry > t_max) continue;
+
+        auto &node = top_nodes[node_index];
+        counts.nodes_visited++;
+
+        if (node.is_leaf()) {
+            counts.box_tests += node.count;
+            for (auto i = node.offset; i < node.offset + node.count; i++) {
+                auto k = instance_order[i];
+                auto &instance = instances[k];
+                auto &mesh = meshes[instance.mesh];
+
+                // a leaf holds up to BVH::max_leaf_size instances, the box of each is tested before its ray is transformed
+                if (instance.world_box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max).is_empty()) continue;
+
+                auto hit = instance.identity ? mesh.wide_bvh.closest_hit(ray, t_min, t_max)
+                                             : mesh.wide_bvh.closest_hit(to_object(instance, ray), t_min, t_max);
+                if (hit.hit) {
+                    record = hit;
+                    record.model_index = k;
+                    t_max = hit.t;
+                }
+            }
+            continue;
+        }
+
+        counts.box_tests += 2;
+        unsigned int near_child = node_index + 1;
+        unsigned int far_child = node.offset;
+        auto near_range = top_nodes[near_child].box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max);
+        auto far_range = top_nodes[far_child].box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max);
+
+        if (far_range.start < near_range.start) {
+            std::swap(near_child, far_child);
+            std::swap(near_range, far_range);
+        }
+
+        if (not far_range.is_empty()) stack[stack_size++] = {far_child, far_range.start};
+        if (not near_range.is_empty()) stack[stack_size++] = {near_child, near_range.start};
+    }
+
+    return record;
+}
+
+void Scene::intersect(RayPacket &packet, float t_min, std::array<HitRecord, RAY_PACKET_SIZE> &records) const {
+    constexpr float inf = std::numeric_limits<float>::infinity();
+
+    for (auto &record: records) {
+        record = {};
+    }
+
+    if (top_nodes.empty()) return;
+
+    TraversalCounts counts;
+    counts.box_tests += RAY_PACKET_SIZE;
+
+    std::array<std::pair<unsigned int, float>, BVH::max_depth> stack;
+    int stack_size = 0;
+
+    float root_entry = packet.entry(top_nodes[0].box, t_min);
+    if (root_entry < inf) {
+        stack[stack_size++] = {0, root_entry};
+    }
+
+    RayPacket object_packet;
+
+    while (stack_size > 0) {
+        auto [node_index, entry] = stack[--stack_size];
+        if (entry > packet.farthest_t_max()) continue;
+
+        auto &node = top_nodes[node_index];
+        counts.nodes_visited++;
+
+        if (node.is_leaf()) {
+            counts.box_tests += node.count * RAY_PACKET_SIZE;
+            for (auto i = node.offset; i < node.offset + node.count; i++) {
+                auto k = instance_order[i];
+                auto &instance = instances[k];
+                auto &mesh = meshes[instance.mesh];
+
+                // as for single rays, the box of each instance is tested before the lanes are transformed
+                if (packet.entry(instance.world_box, t_min) == inf) continue;
+
+                // the lanes keep their t_max, which shrinks in the object space packet as hits are found
+                if (not instance.identity) {
+                    for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                        Ray ray({packet.base_x[lane], packet.base_y[lane], packet.base_z[lane]},
+                                {packet.dir_x[lane], packet.dir_y[lane], packet.dir_z[lane]});
+                        object_packet.set(lane, to_object(instance, ray), packet.t_max[lane]);
+                    }
+                }
+
+                auto &traced = instance.identity ? packet : object_packet;
+                PacketHitRecord packet_record;
+                mesh.bvh.closest_hit(traced, t_min, packet_record);
+
+                for (int lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+                    if (not packet_record.hit[lane]) continue;
+
+                    auto &primitive = mesh.bvh.primitives[packet_record.primitive[lane]];
+                    auto &record = records[lane];
+                    record.hit = true;
+                    record.t = packet_record.t[lane];
+                    record.u = packet_record.u[lane];
+                    record.v = packet_record.v[lane];
+                    record.w = packet_record.w[lane];
+                    record.model_index = k;
+                    record.face_index = primitive.face_index;
+                    packet.t_max[lane] = packet_record.t[lane];
+                }
+            }
+            continue;
+        }
+
+        counts.box_tests += 2 * RAY_PACKET_SIZE;
+        unsigned int near_child = node_index + 1;
+        unsigned int far_child = node.offset;
+        float near_entry = packet.entry(top_nodes[near_child].box, t_min);
+        float far_entry = packet.entry(top_nodes[far_child].box, t_min);
+
+        if (far_entry < near_entry) {
+            std::swap(near_child, far_child);
+            std::swap(near_entry, far_entry);
+        }
+
+        if (far_entry < inf) stack[stack_size++] = {far_child, far_entry};
+        if (near_entry < inf) stack[stack_size++] = {near_child, near_entry};
+    }
+}
+
+float Scene::occlusion(const Ray &ray, float t_min, float t_max) const {
+    float res = 0;
+    if (top_nodes.empty()) return res;
+
+    TraversalCounts counts;
+
+    std::array<unsigned int, BVH::max_depth> stack;
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        auto node_index = stack[--stack_size];
+        auto &node = top_nodes[node_index];
+
+        counts.box_tests++;
+        if (node.box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max).is_empty()) {
+            continue;
+        }
+        counts.nodes_visited++;
+
+        if (not node.is_leaf()) {
+            stack[stack_size++] = node.offset;
+            stack[stack_size++] = node_index + 1;
+            continue;
+        }
+
+        counts.box_tests += node.count;
+        for (auto i = node.offset; i < node.offset + node.count; i++) {
+            auto &instance = instances[instance_order[i]];
+            if (instance.world_box.ray_intersection(ray.base, ray.inv_dir, t_min, t_max).is_empty()) continue;
+
+            auto &mesh = meshes[instance.mesh];
+            auto &model = mesh_models[instance_order[i]].get();
+
+            auto visitor = [&](unsigned int p, float /*t*/, float u, float v, float w) {
+                switch (mesh.opacity[p]) {
+                    case TriangleOpacity::opaque:
+                        res = 1;
+                        return true;
+                    case TriangleOpacity::transparent:
+                        return false;
+                    case TriangleOpacity::alpha_test:
+                        break;
+                }
+
+                auto &tri = model.faces_indices[mesh.bvh.primitives[p].face_index];
+                auto uv = model.vertices[tri.x].texture_coord * u + model.vertices[tri.y].texture_coord * v + model.vertices[tri.z].texture_coord * w;
+
+                res = std::max(res, textures[instance.textures[0]].sample(uv, texture_filter).a);
+                return res >= 1;
+            };
+
+            bool blocked = instance.identity ? mesh.wide_bvh.any_hit(ray, t_min, t_max, visitor)
+                                             : mesh.wide_bvh.any_hit(to_object(instance, ray), t_min, t_max, visitor);
+            if (blocked) return res;
+        }
+    }
+
+    return res;
+}
+
+MeshModel &Scene::model(const HitRecord &record) const {
+    return mesh_models[record.model_index].get();
+}
+
+const SceneInstance &Scene::instance(const HitRecord &record) const {
+    return instances[record.model_index];
+}
+
+const TriangleVerticeIndex &Scene::triangle(const HitRecord &record) const {
+    return model(record).faces_indices[record.face_index];
+}
+
+unsigned int Scene::light_index(const HitRecord &record) const {
+    return first_lights[record.model_index] + record.face_index;
+}
+
+const FloatTexture &Scene::texture(const HitRecord &record, size_t k) const {
+    return textures[instance(record).textures[k]];
+}
+
+AxisAlignedBoundingBox Scene::bounds() const {
+    return top_nodes.empty() ? AxisAlignedBoundingBox() : top_nodes[0].box;
+}
+
+size_t Scene::triangle_count() const {
+    size_t count = 0;
+    for (auto &instance: instances) {
+        count += meshes[instance.mesh].bvh.primitives.size();
+    }
+    return count;
+}
@@ -0,0 +1,32 @@
+#include "common/ray_tracing/texture_sampling.h"
+
+#include <algorithm>
+
+namespace {
+    // the texel of the nearest lookup, clamped so that u = 1 or v = 1 stays inside the image
+    int texel_index(const Texture &texture, float u, float v) {
+        int sample_i = std::clamp(int(u * texture.width), 0, texture.width - 1);
+        int sample_j = std::clamp(int(v * texture.height), 0, texture.height - 1);
+        return sample_j * texture.width + sample_i;
+    }
+}
+
+glm::vec3 get_texture_rgb(const Texture &texture, float u, float v) {
+    auto *data = reinterpret_cast<const RGB*>(texture.data);
+    RGB item = data[texel_index(texture, u, v)];
+    return { float(item.r) / 255, float(item.g) / 255, float(item.b) / 255 };
+}
+
+glm::vec4 get_texture_rgba(const Texture &texture, float u, float v) {
+    auto *data = reinterpret_cast<const RGBA*>(texture.data);
+    auto item = data[texel_index(texture, u, v)];
+    return { float(item.r) / 255, float(item.g) / 255, float(item.b) / 255, float(item.a) / 255 };
+}
+
+glm::vec3 get_texture(const Texture &texture, float u, float v) {
+    if (texture.num_channels == 3) {
+        return get_texture_rgb(texture, u, v);
+    } else {
+        return glm::vec3(get_texture_rgba(texture, u, v));
+    }
+}
@@ -0,0 +1,111 @@
+#include "common/ray_tracing/tile_scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+TileScheduler::TileScheduler(int width, int height, int tile_size, TileOrder order) {
+    int tile_rows = (height + tile_size - 1) / tile_size;
+    int tile_columns = (width + tile_size - 1) / tile_size;
+
+    for (int i = 0; i < tile_rows; i++) {
+        for (int j = 0; j < tile_columns; j++) {
+            tiles.push_back({
+                j * tile_size, i * tile_size,
+                std::min(width, (j + 1) * tile_size), std::min(height, (i + 1) * tile_size)
+            });
+        }
+    }
+
+    if (order == TileOrder::spiral) {
+        float center_x = 0.5f * width;
+        float center_y = 0.5f * height;
+
+        // ring index in tiles around the centre, then the angle inside the ring
+        auto key = [&](const Tile &tile) {
+            float dx = (0.5f * (tile.x_begin + tile.x_end) - center_x) / float(tile_size);
+            float dy = (0.5f * (tile.y_begin + tile.y_end) - center_y) / float(tile_size);
+            int ring = int(std::round(std::max(std::fabs(dx), std::fabs(dy))));
+            return std::make_pair(ring, std::atan2(dy, dx));
+        };
+
+        std::ranges::stable_sort(tiles, [&](const Tile &a, const Tile &b) { return key(a) < key(b); });
+    }
+}
+
+int TileScheduler::resolve_thread_count(int thread_count) {
+    if (thread_count > 0) return thread_count;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void TileScheduler::run(int thread_count, const std::function<void(const Tile &, int)> &render_tile,
+                        const std::function<void(int, int)> &progress) const {
+    thread_count = std::min<int>(resolve_thread_count(thread_count), std::max<size_t>(1, tiles.size()));
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<int> tile_indices;
+    };
+
+    std::vector<WorkQueue> queues(thread_count);
+
+    // deal the tiles round robin, so every queue starts with tiles from the front of the order
+    for (size_t i = 0; i < tiles.size(); i++) {
+        queues[i % thread_count].tile_indices.push_back(i);
+    }
+
+    std::mutex progress_mutex;
+    std::atomic<int> finished = 0;
+    int total = tiles.size();
+
+    auto take = [&](int thread_index) -> int {
+        {
+            auto &queue = queues[thread_index];
+            std::lock_guard lock(queue.mutex);
+            if (not queue.tile_indices.empty()) {
+                int index = queue.tile_indices.front();
+                queue.tile_indices.pop_front();
+                return index;
+            }
+        }
+
+        // steal from the back of the other queues, starting with the next thread
+        for (int k = 1; k < thread_count; k++) {
+            auto &victim = queues[(thread_index + k) % thread_count];
+            std::lock_guard lock(victim.mutex);
+            if (not victim.tile_indices.empty()) {
+                int index = victim.tile_indices.back();
+                victim.tile_indices.pop_back();
+                return index;
+            }
+        }
+
+        return -1;
+    };
+
+    auto worker = [&](int thread_index) {
+        // no tile is ever pushed back, so once every queue is empty the work is done
+        for (int index = take(thread_index); index != -1; index = take(thread_index)) {
+            render_tile(tiles[index], thread_index);
+
+            int done = ++finished;
+            if (progress) {
+                std::lock_guard lock(progress_mutex);
+                progress(done, total);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < thread_count; i++) {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
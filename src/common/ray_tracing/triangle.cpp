@@ -0,0 +1,72 @@
+#include "common/ray_tracing/triangle.h"
+
+void TriangleBuffer::clear() {
+    for (auto component: {&v0_x, &v0_y, &v0_z, &e1_x, &e1_y, &e1_z, &e2_x, &e2_y, &e2_z}) {
+        component->clear();
+    }
+}
+
+void TriangleBuffer::reserve(size_t count) {
+    for (auto component: {&v0_x, &v0_y, &v0_z, &e1_x, &e1_y, &e1_z, &e2_x, &e2_y, &e2_z}) {
+        component->reserve(count);
+    }
+}
+
+void TriangleBuffer::push_back(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2) {
+    auto e1 = v1 - v0;
+    auto e2 = v2 - v0;
+
+    v0_x.push_back(v0.x);
+    v0_y.push_back(v0.y);
+    v0_z.push_back(v0.z);
+    e1_x.push_back(e1.x);
+    e1_y.push_back(e1.y);
+    e1_z.push_back(e1.z);
+    e2_x.push_back(e2.x);
+    e2_y.push_back(e2.y);
+    e2_z.push_back(e2.z);
+}
+
+void TriangleBuffer::set(size_t i, const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2) {
+    auto e1 = v1 - v0;
+    auto e2 = v2 - v0;
+
+    v0_x[i] = v0.x;
+    v0_y[i] = v0.y;
+    v0_z[i] = v0.z;
+    e1_x[i] = e1.x;
+    e1_y[i] = e1.y;
+    e1_z[i] = e1.z;
+    e2_x[i] = e2.x;
+    e2_y[i] = e2.y;
+    e2_z[i] = e2.z;
+}
+
+glm::vec3 TriangleBuffer::vertex(size_t i, int k) const {
+    glm::vec3 v0 {v0_x[i], v0_y[i], v0_z[i]};
+    if (k == 1) return v0 + glm::vec3 {e1_x[i], e1_y[i], e1_z[i]};
+    if (k == 2) return v0 + glm::vec3 {e2_x[i], e2_y[i], e2_z[i]};
+    return v0;
+}
+
+TriangleBlock::TriangleBlock() {
+    for (int slot = 0; slot < TRIANGLE_BLOCK_SIZE; slot++) {
+        v0_x[slot] = v0_y[slot] = v0_z[slot] = 0;
+        e1_x[slot] = e1_y[slot] = e1_z[slot] = 0;
+        e2_x[slot] = e2_y[slot] = e2_z[slot] = 0;
+        primitive[slot] = 0;
+    }
+}
+
+void TriangleBlock::set(int slot, const TriangleBuffer &triangles, unsigned int i) {
+    v0_x[slot] = triangles.v0_x[i];
+    v0_y[slot] = triangles.v0_y[i];
+    v0_z[slot] = triangles.v0_z[i];
+    e1_x[slot] = triangles.e1_x[i];
+    e1_y[slot] = triangles.e1_y[i];
+    e1_z[slot] = triangles.e1_z[i];
+    e2_x[slot] = triangles.e2_x[i];
+    e2_y[slot] = triangles.e2_y[i];
+    e2_z[slot] = triangles.e2_z[i];
+    primitive[slot] = i;
+}
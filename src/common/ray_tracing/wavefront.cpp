@@ -0,0 +1,168 @@
+#include "common/ray_tracing/wavefront.h"
+#include "common/ray_tracing/ray_tracing.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // spreads the lower 10 bits of x to every third bit
+    uint32_t spread_bits(uint32_t x) {
+        x &= 0x3ff;
+        x = (x | (x << 16)) & 0x030000ff;
+        x = (x | (x << 8)) & 0x0300f00f;
+        x = (x | (x << 4)) & 0x030c30c3;
+        x = (x | (x << 2)) & 0x09249249;
+        return x;
+    }
+
+    // position of value in the range quantized to 10 bits, clamped to the range
+    uint32_t quantize(float value, const Interval &range) {
+        float extent = range.end - range.start;
+        float x = extent > 0 ? (value - range.start) / extent : 0;
+        return uint32_t(std::clamp(x, 0.0f, 1.0f) * 1023.0f);
+    }
+}
+
+WavefrontIntegrator::WavefrontIntegrator(const Scene &t_scene): scene(t_scene), bounds(t_scene.bounds()) {}
+
+// the octant of the direction in the top bits, then the Morton code of the origin
+uint32_t WavefrontIntegrator::sort_key(const Ray &ray) const {
+    uint32_t octant = uint32_t(ray.dir.x < 0) | uint32_t(ray.dir.y < 0) << 1 | uint32_t(ray.dir.z < 0) << 2;
+
+    uint32_t morton = spread_bits(quantize(ray.base.x, bounds.x_range))
+                    | spread_bits(quantize(ray.base.y, bounds.y_range)) << 1
+                    | spread_bits(quantize(ray.base.z, bounds.z_range)) << 2;
+
+    return octant << 30 | morton;
+}
+
+// rays with equal keys keep their order, the primary rays of a tile stay in pixel order
+void WavefrontIntegrator::sort_paths() {
+    keys.resize(paths.size());
+    for (size_t r = 0; r < paths.size(); r++) {
+        keys[r] = uint64_t(sort_key(paths[r].ray)) << 32 | r;
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    next_paths.resize(paths.size());
+    for (size_t r = 0; r < keys.size(); r++) {
+        next_paths[r] = paths[uint32_t(keys[r])];
+    }
+
+    std::swap(paths, next_paths);
+    next_paths.clear();
+}
+
+void WavefrontIntegrator::trace_paths() {
+    records.resize(paths.size());
+    for (size_t r = 0; r < paths.size(); r++) {
+        records[r] = scene.intersect(paths[r].ray, 1e-5, std::numeric_limits<float>::infinity());
+    }
+}
+
+// a missed ray adds the environment, every hit queues its shadow rays and at most one ray of the next bounce
+void WavefrontIntegrator::shade_hits() {
+    keys.clear();
+    for (size_t r = 0; r < records.size(); r++) {
+        if (records[r].hit) {
+            keys.push_back(uint64_t(records[r].model_index) << 32 | r);
+        } else if (not scene.environment.empty()) {
+            auto &path = paths[r];
+            radiance[path.sample] += path.throughput * scene.environment.radiance(path.ray.dir) * path.light_color;
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    shadow_rays.clear();
+    for (auto key: keys) {
+        auto &path = paths[uint32_t(key)];
+        auto surface = ray_tracing_surface(path.ray, records[uint32_t(key)], path.depth, path.light_color, scene,
+                                           path.random, path.differential);
+
+        radiance[path.sample] += path.throughput * surface.unshadowed;
+        for (int k = 0; k < surface.light_count; k++) {
+            shadow_rays.push_back({surface.position, surface.light_positions[k], path.throughput * surface.shadowed[k], path.sample});
+        }
+
+        float throughput = path.throughput * surface.continuation_weight;
+        int depth = surface.continuation_depth;
+        if (depth > MAX_RAY_TRACING_DEPTH or throughput < MIN_RAY_TRACING_THROUGHPUT) {
+            continue;
+        }
+
+        if (auto counters = thread_ray_counters) {
+            counters->secondary_rays++;
+        }
+        next_paths.push_back({surface.continuation, throughput, surface.continuation_light_color, depth,
+                              surface.continuation_differential, path.random.bounce(depth), path.sample});
+    }
+}
+
+void WavefrontIntegrator::trace_shadow_rays() {
+    for (auto &shadow_ray: shadow_rays) {
+        float shadow = shadow_test(shadow_ray.position, shadow_ray.light_position, scene);
+        radiance[shadow_ray.sample] += (1.0f - shadow) * shadow_ray.shadowed;
+    }
+}
+
+void WavefrontIntegrator::render_tile(const Tile &tile, int samples_per_pixel, const PrimaryRay &primary_ray, FrameBuffer &framebuffer,
+                                      const std::vector<unsigned char> *active) {
+    int tile_width = tile.x_end - tile.x_begin;
+    int tile_height = tile.y_end - tile.y_begin;
+
+    auto is_active = [&](int i, int j) {
+        return active == nullptr or (*active)[framebuffer.pixel_index(j, i)];
+    };
+
+    auto sample_index = [&](int i, int j, int k) {
+        return unsigned(((i - tile.y_begin) * tile_width + (j - tile.x_begin)) * samples_per_pixel + k);
+    };
+
+    radiance.assign(size_t(tile_width) * tile_height * samples_per_pixel, glm::vec3(0));
+
+    bool has_auxiliary = framebuffer.has_auxiliary_channels();
+    if (has_auxiliary) {
+        auxiliary.assign(radiance.size(), {});
+    }
+
+    paths.clear();
+    for (int i = tile.y_begin; i < tile.y_end; i++) {
+        for (int j = tile.x_begin; j < tile.x_end; j++) {
+            if (not is_active(i, j)) continue;
+
+            int first_sample = int(framebuffer.sample_count(j, i));
+            for (int k = 0; k < samples_per_pixel; k++) {
+                auto [ray, differential, random] = primary_ray(i, j, first_sample + k);
+                paths.push_back({ray, 1.0f, {1, 1, 1}, 1, differential, random, sample_index(i, j, k)});
+            }
+        }
+    }
+
+    for (bool primary = true; not paths.empty(); primary = false) {
+        sort_paths();
+        trace_paths();
+        if (primary and has_auxiliary) {
+            for (size_t r = 0; r < paths.size(); r++) {
+                auxiliary[paths[r].sample] = auxiliary_sample(paths[r].ray, records[r], scene, paths[r].differential);
+            }
+        }
+        shade_hits();
+        trace_shadow_rays();
+        std::swap(paths, next_paths);
+    }
+
+    for (int i = tile.y_begin; i < tile.y_end; i++) {
+        for (int j = tile.x_begin; j < tile.x_end; j++) {
+            if (not is_active(i, j)) continue;
+
+            for (int k = 0; k < samples_per_pixel; k++) {
+                framebuffer.accumulate(j, i, radiance[sample_index(i, j, k)]);
+                if (has_auxiliary) {
+                    framebuffer.accumulate(j, i, auxiliary[sample_index(i, j, k)]);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,155 @@
+#include "common/ray_tracing/wide_bvh.h"
+
+void WideBVH::build(const BVH &bvh) {
+    nodes.clear();
+    blocks.clear();
+    primitives = bvh.primitives;
+
+    if (bvh.nodes.empty()) return;
+
+    nodes.reserve(bvh.nodes.size() / (WIDE_BVH_WIDTH - 1) + 1);
+    blocks.reserve(bvh.primitives.size() / TRIANGLE_BLOCK_SIZE + bvh.nodes.size() / 2 + 1);
+    collapse(bvh, 0);
+}
+
+unsigned int WideBVH::collapse(const BVH &bvh, unsigned int binary_index) {
+    // open the interior child with the largest surface area until the node is full
+    std::vector<unsigned int> children;
+    if (bvh.nodes[binary_index].is_leaf()) {
+        children.push_back(binary_index);
+    } else {
+        children = {binary_index + 1, bvh.nodes[binary_index].offset};
+    }
+
+    while (children.size() < WIDE_BVH_WIDTH) {
+        int best = -1;
+        float best_area = -1;
+        for (size_t k = 0; k < children.size(); k++) {
+            auto &child = bvh.nodes[children[k]];
+            if (not child.is_leaf() and child.box.surface_area() > best_area) {
+                best = int(k);
+                best_area = child.box.surface_area();
+            }
+        }
+        if (best == -1) break;
+
+        auto opened = children[best];
+        children[best] = opened + 1;
+        children.push_back(bvh.nodes[opened].offset);
+    }
+
+    unsigned int node_index = nodes.size();
+    nodes.push_back({});
+
+    WideBVHNode node {};
+    node.child_count = children.size();
+
+    for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++) {
+        if (slot >= node.child_count) {
+            node.min_x[slot] = node.min_y[slot] = node.min_z[slot] = 0;
+            node.max_x[slot] = node.max_y[slot] = node.max_z[slot] = 0;
+            continue;
+        }
+
+        auto &child = bvh.nodes[children[slot]];
+        node.min_x[slot] = child.box.x_range.start;
+        node.min_y[slot] = child.box.y_range.start;
+        node.min_z[slot] = child.box.z_range.start;
+        node.max_x[slot] = child.box.x_range.end;
+        node.max_y[slot] = child.box.y_range.end;
+        node.max_z[slot] = child.box.z_range.end;
+
+        if (child.is_leaf()) {
+            node.child[slot] = blocks.size();
+            node.block_count[slot] = (child.count + TRIANGLE_BLOCK_SIZE - 1) / TRIANGLE_BLOCK_SIZE;
+
+            for (unsigned int k = 0; k < child.count; k++) {
+                if (k % TRIANGLE_BLOCK_SIZE == 0) blocks.emplace_back();
+                blocks.back().set(k % TRIANGLE_BLOCK_SIZE, bvh.triangles, child.offset + k);
+            }
+        } else {
+            node.child[slot] = collapse(bvh, children[slot]);
+            node.block_count[slot] = 0;
+        }
+    }
+
+    nodes[node_index] = node;
+    return node_index;
+}
+
+HitRecord WideBVH::closest_hit(const Ray &ray, float t_min, float t_max) const {
+    HitRecord record;
+    if (nodes.empty()) return record;
+
+    TraversalCounts counts;
+
+    std::array<StackEntry, max_stack_size> stack;
+    int stack_size = 0;
+    stack[stack_size++] = {0, 0, t_min};
+
+    alignas(32) float entry[WIDE_BVH_WIDTH];
+    alignas(32) int hit[TRIANGLE_BLOCK_SIZE];
+    alignas(32) float t[TRIANGLE_BLOCK_SIZE], u[TRIANGLE_BLOCK_SIZE], v[TRIANGLE_BLOCK_SIZE], w[TRIANGLE_BLOCK_SIZE];
+
+    unsigned int hit_primitive = 0;
+
+    while (stack_size > 0) {
+        auto current = stack[--stack_size];
+
+        // a closer hit may have been found since the entry was pushed
+        if (current.entry > t_max) continue;
+
+        counts.nodes_visited++;
+        if (current.block_count > 0) {
+            counts.triangle_tests += current.block_count * TRIANGLE_BLOCK_SIZE;
+            for (auto b = current.index; b < current.index + current.block_count; b++) {
+                auto &block = blocks[b];
+                if (block.intersect(ray, t_min, t_max, hit, t, u, v, w) == 0) continue;
+
+                int nearest = 0;
+                for (int slot = 1; slot < TRIANGLE_BLOCK_SIZE; slot++) {
+                    if (t[slot] < t[nearest]) nearest = slot;
+                }
+
+                t_max = t[nearest];
+                record.hit = true;
+                record.t = t[nearest];
+                record.u = u[nearest];
+                record.v = v[nearest];
+                record.w = w[nearest];
+                hit_primitive = block.primitive[nearest];
+            }
+            continue;
+        }
+
+        auto &node = nodes[current.index];
+        counts.box_tests += node.child_count;
+        auto mask = intersect_children(node, ray, t_min, t_max, entry);
+
+        // order the children hit from the farthest to the nearest entry, so that the nearest is popped first
+        std::array<int, WIDE_BVH_WIDTH> order;
+        int order_size = 0;
+        for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++) {
+            if (not (mask >> slot & 1)) continue;
+
+            int k = order_size++;
+            while (k > 0 and entry[order[k - 1]] < entry[slot]) {
+                order[k] = order[k - 1];
+                k--;
+            }
+            order[k] = slot;
+        }
+
+        for (int k = 0; k < order_size; k++) {
+            int slot = order[k];
+            stack[stack_size++] = {node.child[slot], node.block_count[slot], entry[slot]};
+        }
+    }
+
+    if (record.hit) {
+        record.model_index = primitives[hit_primitive].model_index;
+        record.face_index = primitives[hit_primitive].face_index;
+    }
+
+    return record;
+}
@@ -11,6 +11,7 @@
 #include <ranges>
 #include <fstream>
 #include <array>
+#include <memory>
 
 #include "common/camera/camera.hxx"
 #include "common/constructor/constructor.hxx"
@@ -20,8 +21,10 @@
 #include "common/simulation/solid_entity.hxx"
 #include "common/io/model_io.h"
 #include "common/io/render_output.h"
+#include "common/io/image_output.h"
 
 #include "common/ray_tracing/ray_tracing.h"
+#include "common/ray_tracing/progressive.h"
 
 #ifndef SHADER_DIR
 #define SHADER_DIR "./shader"
@@ -47,6 +50,13 @@ const unsigned int SCR_HEIGHT = 1024;
 constexpr unsigned int SHADOW_WIDTH = 2048;
 constexpr unsigned int SHADOW_HEIGHT = 2048;
 
+// the progressive preview is shown in the top right corner of the window
+constexpr int PREVIEW_WIDTH = SCR_WIDTH / 2;
+constexpr int PREVIEW_HEIGHT = SCR_HEIGHT / 2;
+
+// seconds between two uploads of the preview estimate
+constexpr float PREVIEW_UPLOAD_INTERVAL = 0.25f;
+
 glm::mat4 view = glm::mat4(1.0f);
 glm::mat4 projection = glm::mat4(1.0f);
 
@@ -69,10 +79,38 @@ MeshModel mirror2 = Constructor::Rectangle({-0.5, -0.5, 1.5}, {-0.5, 0.5, 1.5},
 
 std::vector<std::reference_wrapper<MeshModel>> mesh_models{ sphere, sphere2, cubic2, mirror, mirror2, cubic};
 
+// the faces of the skybox, read from the image cache once the skybox is loaded
+EnvironmentMap environment;
+
+// the ray traced images are lit by a point light where the light source is drawn and surrounded by the skybox
+Scene ray_tracing_scene() {
+    Light light;
+    light.position = lightPos;
+
+    Scene scene(mesh_models, {light});
+    scene.environment = environment;
+    return scene;
+}
+
 bool render = false;
 
 std::array<std::array<glm::vec3, 256>, 256> tmp_image;
 
+// created on the first use of the preview, the scene is built once from the models of that moment
+std::unique_ptr<ProgressiveRenderer> preview;
+bool show_preview = false;
+bool preview_key_pressed = false;
+
+// the camera the preview was started from, moving away from it restarts the preview
+glm::vec3 preview_position;
+glm::vec3 preview_front;
+
+void restart_preview() {
+    preview_position = camera.position;
+    preview_front = camera.camera_front;
+    preview->restart(camera);
+}
+
 void processInput(GLFWwindow* window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
@@ -95,12 +133,37 @@ void processInput(GLFWwindow* window) {
         enable_filter = true;
     if (glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS) {
         if (not render) {
-            auto target_models = mesh_models;
-            ray_tracing(camera, target_models);
+            RayTracingSettings settings;
+            settings.progress = [](int finished, int total) {
+                std::cerr << std::format("\rray tracing {}/{} tiles", finished, total);
+            };
+            FrameBuffer framebuffer(SCR_WIDTH, SCR_HEIGHT);
+            ray_tracing(camera, ray_tracing_scene(), framebuffer, settings);
+            write_image(framebuffer, std::string("render.ppm"));
             render = true;
             std::cout << "output finish" << std::endl;
         }
     }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS) {
+        if (not preview_key_pressed) {
+            show_preview = not show_preview;
+            if (show_preview) {
+                if (not preview) {
+                    RayTracingSettings settings;
+                    settings.samples_per_pixel = 1;
+                    // leave a core to the window
+                    settings.thread_count = std::max(1, TileScheduler::resolve_thread_count(0) - 1);
+                    preview = std::make_unique<ProgressiveRenderer>(ray_tracing_scene(), PREVIEW_WIDTH, PREVIEW_HEIGHT, settings);
+                }
+                restart_preview();
+            } else {
+                preview->stop();
+            }
+        }
+        preview_key_pressed = true;
+    } else {
+        preview_key_pressed = false;
+    }
     if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS) {
         if (not render) {
             auto texture = mirror.textures[0];
@@ -264,6 +327,46 @@ int main(int argc, char **argv) {
         std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // quad and texture for the progressive preview, the estimate is stored from the top row down
+    float preview_vertices[] = {
+            -1.0f,  1.0f,  0.0f, 0.0f,
+            -1.0f, -1.0f,  0.0f, 1.0f,
+             1.0f, -1.0f,  1.0f, 1.0f,
+
+            -1.0f,  1.0f,  0.0f, 0.0f,
+             1.0f, -1.0f,  1.0f, 1.0f,
+             1.0f,  1.0f,  1.0f, 0.0f
+    };
+
+    unsigned int preview_VAO, preview_VBO;
+    glGenVertexArrays(1, &preview_VAO);
+    glGenBuffers(1, &preview_VBO);
+    glBindVertexArray(preview_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, preview_VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(preview_vertices), preview_vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glBindVertexArray(0);
+
+    unsigned int preview_texture;
+    glGenTextures(1, &preview_texture);
+    glBindTexture(GL_TEXTURE_2D, preview_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, PREVIEW_WIDTH, PREVIEW_HEIGHT, 0, GL_RGB, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    Shader preview_shader(std::format("{}/filter.vs", shader_root), std::format("{}/preview.fs", shader_root));
+    preview_shader.use();
+    preview_shader.set_int("previewTexture", 0);
+
+    std::vector<glm::vec3> preview_colors;
+    int uploaded_passes = 0;
+    float last_upload = 0;
+
     auto mesh_from_obj = ModelIO().read_obj_model(std::format("{}/nanosuit/nanosuit.obj", model_root));
 
     std::ranges::for_each(mesh_from_obj, [&](auto &x){ mesh_models.push_back(x); });
@@ -301,6 +404,7 @@ int main(int argc, char **argv) {
     SkyBox skybox;
     skybox.load_cube_map(faces);
     skybox.bind();
+    environment = EnvironmentMap(skybox.images);
 
     Shader skybox_shader(std::format("{}/simple.vs", skybox_root), std::format("{}/simple.fs", skybox_root));
     skybox_shader.use();
@@ -327,11 +431,11 @@ int main(int argc, char **argv) {
         config_fstream >> op >> ax >> ay >> az >> bx >> by >> bz;
         std::cout << std::format("{} {} {} {} {} {}\n", ax, ay, az, bx, by, bz);
         if (op == 0) {
-            config_model[i] = Constructor::Cubic({ax, ay ,az}, {bx, by, bz});
+            config_model[i] = Constructor::PlacedCubic({ax, ay ,az}, {bx, by, bz});
             config_model[i].object_color = {0.5, 0.1, 0};
             mesh_models.emplace_back(config_model[i]);
         } else if (op == 1) {
-            config_model[i] = Constructor::Cubic({ax, ay ,az}, {bx, by, bz});
+            config_model[i] = Constructor::PlacedCubic({ax, ay ,az}, {bx, by, bz});
             config_model[i].reflection = true;
             reflect_models.emplace_back(config_model[i]);
         } else if (op == 2) {
@@ -352,6 +456,21 @@ int main(int argc, char **argv) {
 
         processInput(window);
 
+        if (show_preview) {
+            if (camera.position != preview_position or camera.camera_front != preview_front) {
+                restart_preview();
+                uploaded_passes = 0;
+            }
+
+            // the estimate only changes when a pass is merged, the upload rate bounds the copies
+            if (currentFrame - last_upload >= PREVIEW_UPLOAD_INTERVAL and preview->passes() != uploaded_passes) {
+                uploaded_passes = preview->copy_estimate(preview_colors);
+                glBindTexture(GL_TEXTURE_2D, preview_texture);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, PREVIEW_WIDTH, PREVIEW_HEIGHT, GL_RGB, GL_FLOAT, preview_colors.data());
+                last_upload = currentFrame;
+            }
+        }
+
         glm::mat4 lightProjection, lightView;
         glm::mat4 lightSpaceMatrix;
         float near_plane = 1.0f, far_plane = 100.5f;
@@ -423,10 +542,28 @@ int main(int argc, char **argv) {
             glEnable(GL_DEPTH_TEST);
         }
 
+        if (show_preview) {
+            glViewport(SCR_WIDTH - PREVIEW_WIDTH, SCR_HEIGHT - PREVIEW_HEIGHT, PREVIEW_WIDTH, PREVIEW_HEIGHT);
+            glDisable(GL_DEPTH_TEST);
+
+            preview_shader.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, preview_texture);
+            glBindVertexArray(preview_VAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindVertexArray(0);
+
+            glEnable(GL_DEPTH_TEST);
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        }
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    // the preview threads read the models, they stop before the models go away
+    preview.reset();
+
     glfwTerminate();
 
     return 0;
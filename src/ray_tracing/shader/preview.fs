@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D previewTexture;
+
+void main()
+{
+    vec3 col = texture(previewTexture, TexCoords).rgb;
+
+    FragColor = vec4(clamp(col, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,354 @@
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "common/camera/camera.hxx"
+#include "common/constructor/constructor.hxx"
+#include "common/mesh_model.hxx"
+#include "common/io/model_io.h"
+#include "common/io/image_output.h"
+#include "common/io/scene_config.h"
+
+#include "common/ray_tracing/ray_tracing.h"
+#include "common/ray_tracing/denoiser.h"
+
+#ifndef TEXTURE_DIR
+#define TEXTURE_DIR "./texture"
+#endif
+
+#ifndef MODEL_DIR
+#define MODEL_DIR "./model"
+#endif
+
+/*
+ * Renders the scene of the ray tracing viewer without a window or a GL context and writes the image to a file.
+ */
+
+struct Options {
+    std::string config_path;
+    std::string output_path {"render.png"};
+    std::string texture_root {TEXTURE_DIR};
+    std::string model_root {MODEL_DIR};
+    bool load_model {true};
+
+    int width {1024};
+    int height {1024};
+
+    glm::vec3 camera_position {0.5, 0.5, 5.0f};
+
+    // the default light of the ray tracer is used when none is given
+    std::vector<Light> lights;
+    int light_samples {4};
+
+    // emissive spheres added to the models
+    std::vector<MeshModel> area_lights;
+
+    // directory of the six faces of the sky the missed rays see, black without it
+    std::string skybox_root;
+
+    // filter the image guided by the first hits before writing it
+    bool denoise {false};
+    DenoiserSettings denoiser;
+
+    // the counters and timings of the render as JSON and the time spent on every pixel as an image, skipped when empty
+    std::string stats_path;
+    std::string heatmap_path;
+
+    ImageOutputSettings image_settings;
+    RayTracingSettings settings;
+};
+
+void print_usage(const char *program) {
+    std::cout << std::format("usage: {} [options]\n", program)
+              << "  --config <path>          entity config in the format of the viewer\n"
+              << "  --output <path>          image to write, the extension picks ppm, pfm, png or hdr (render.png)\n"
+              << "  --width <n>              image width (1024)\n"
+              << "  --height <n>             image height (1024)\n"
+              << "  --spp <n>                samples per pixel (4)\n"
+              << "  --adaptive <threshold>   more samples where the relative error of a pixel is above the threshold\n"
+              << "  --max-spp <n>            samples per pixel limit of adaptive sampling (64)\n"
+              << "  --time-budget <seconds>  stop adaptive sampling after this render time\n"
+              << "  --threads <n>            render threads, 0 uses every hardware thread (0)\n"
+              << "  --seed <n>               seed of the sample streams (0)\n"
+              << "  --camera <x> <y> <z>     camera position (0.5 0.5 5)\n"
+              << "  --light <x> <y> <z> <r> <g> <b>\n"
+              << "                           add a point light, the first one replaces the light at (-7 7 10)\n"
+              << "  --area-light <x> <y> <z> <radius> <r> <g> <b>\n"
+              << "                           add an emissive sphere of the given radiance\n"
+              << "  --light-samples <n>      shadow rays per shading point, picked by power among more lights (4)\n"
+              << "  --skybox <path>          directory of the skybox faces right.jpg ... back.jpg seen by the missed rays\n"
+              << "  --integrator <name>      recursive, wavefront or path (recursive)\n"
+              << "  --min-bounces <n>        path integrator: bounces before Russian roulette (3)\n"
+              << "  --max-bounces <n>        path integrator: longest path (64)\n"
+              << "  --denoise                filter the noise guided by the albedo, normal and depth of the first hits\n"
+              << "  --denoise-iterations <n> passes of the denoiser, more smooth out fewer samples per pixel (5)\n"
+              << "  --stats <path>           write the ray counts and the tile timings of the render as JSON\n"
+              << "  --heatmap <path>         write the time spent on every pixel as a false colour image\n"
+              << "  --tone-mapping <name>    clamp, reinhard or aces (clamp)\n"
+              << "  --texture-dir <path>     directory of container.jpg and mirror.png\n"
+              << "  --model-dir <path>       directory holding nanosuit/nanosuit.obj\n"
+              << "  --no-model               skip the nanosuit model\n";
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        // the next argument as the value of the flag
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                std::cerr << std::format("missing value for {}\n", arg);
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--help" or arg == "-h") {
+            print_usage(argv[0]);
+            std::exit(0);
+        } else if (arg == "--config") {
+            options.config_path = value();
+        } else if (arg == "--output") {
+            options.output_path = value();
+        } else if (arg == "--width") {
+            options.width = std::atoi(value());
+        } else if (arg == "--height") {
+            options.height = std::atoi(value());
+        } else if (arg == "--spp") {
+            options.settings.samples_per_pixel = std::atoi(value());
+        } else if (arg == "--adaptive") {
+            options.settings.adaptive.enabled = true;
+            options.settings.adaptive.error_threshold = std::atof(value());
+        } else if (arg == "--max-spp") {
+            options.settings.adaptive.max_samples_per_pixel = std::atoi(value());
+        } else if (arg == "--time-budget") {
+            options.settings.adaptive.time_budget = std::atof(value());
+        } else if (arg == "--threads") {
+            options.settings.thread_count = std::atoi(value());
+            options.image_settings.thread_count = options.settings.thread_count;
+            options.denoiser.thread_count = options.settings.thread_count;
+        } else if (arg == "--seed") {
+            options.settings.seed = std::strtoul(value(), nullptr, 10);
+        } else if (arg == "--camera") {
+            options.camera_position.x = std::atof(value());
+            options.camera_position.y = std::atof(value());
+            options.camera_position.z = std::atof(value());
+        } else if (arg == "--light") {
+            // the values are read one statement at a time, the order of the arguments of a call is unspecified
+            Light light;
+            for (int axis = 0; axis < 3; axis++) light.position[axis] = std::atof(value());
+            for (int channel = 0; channel < 3; channel++) light.color[channel] = std::atof(value());
+            options.lights.push_back(light);
+        } else if (arg == "--area-light") {
+            glm::vec3 center;
+            for (int axis = 0; axis < 3; axis++) center[axis] = std::atof(value());
+            float radius = std::atof(value());
+            auto sphere = Constructor::Sphere(Point3d(center.x, center.y, center.z), radius);
+            for (int channel = 0; channel < 3; channel++) sphere.emission[channel] = std::atof(value());
+            sphere.object_color = {0, 0, 0};
+            options.area_lights.push_back(std::move(sphere));
+        } else if (arg == "--light-samples") {
+            options.light_samples = std::atoi(value());
+        } else if (arg == "--skybox") {
+            options.skybox_root = value();
+        } else if (arg == "--integrator") {
+            std::string name = value();
+            if (name == "recursive") {
+                options.settings.integrator = RayTracingIntegrator::recursive;
+            } else if (name == "wavefront") {
+                options.settings.integrator = RayTracingIntegrator::wavefront;
+            } else if (name == "path") {
+                options.settings.integrator = RayTracingIntegrator::path;
+            } else {
+                std::cerr << std::format("unknown integrator {}\n", name);
+                return false;
+            }
+        } else if (arg == "--min-bounces") {
+            options.settings.path.min_bounces = std::atoi(value());
+        } else if (arg == "--max-bounces") {
+            options.settings.path.max_bounces = std::atoi(value());
+        } else if (arg == "--denoise") {
+            options.denoise = true;
+        } else if (arg == "--denoise-iterations") {
+            options.denoise = true;
+            options.denoiser.iterations = std::atoi(value());
+        } else if (arg == "--stats") {
+            options.stats_path = value();
+        } else if (arg == "--heatmap") {
+            options.heatmap_path = value();
+        } else if (arg == "--tone-mapping") {
+            std::string name = value();
+            if (name == "clamp") {
+                options.image_settings.tone_mapping = ToneMapping::clamp;
+            } else if (name == "reinhard") {
+                options.image_settings.tone_mapping = ToneMapping::reinhard;
+            } else if (name == "aces") {
+                options.image_settings.tone_mapping = ToneMapping::aces;
+            } else {
+                std::cerr << std::format("unknown tone mapping {}\n", name);
+                return false;
+            }
+        } else if (arg == "--texture-dir") {
+            options.texture_root = value();
+        } else if (arg == "--model-dir") {
+            options.model_root = value();
+        } else if (arg == "--no-model") {
+            options.load_model = false;
+        } else {
+            std::cerr << std::format("unknown option {}\n", arg);
+            return false;
+        }
+    }
+
+    if (options.width <= 0 or options.height <= 0 or options.settings.samples_per_pixel <= 0) {
+        std::cerr << "width, height and spp must be positive\n";
+        return false;
+    }
+
+    return true;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (not parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto load_start = std::chrono::steady_clock::now();
+
+    auto models = ray_tracing_demo_models(options.texture_root);
+
+    if (options.load_model) {
+        auto model_path = std::format("{}/nanosuit/nanosuit.obj", options.model_root);
+        if (std::filesystem::exists(model_path)) {
+            auto mesh_from_obj = ModelIO(false).read_obj_model(model_path);
+            std::ranges::move(mesh_from_obj, std::back_inserter(models));
+        } else {
+            std::cerr << std::format("model {} not found, rendering without it\n", model_path);
+        }
+    }
+
+    if (not options.config_path.empty()) {
+        auto config_models = read_scene_config(options.config_path, options.texture_root);
+        std::ranges::move(config_models, std::back_inserter(models));
+    }
+
+    std::ranges::move(options.area_lights, std::back_inserter(models));
+
+    EnvironmentMap environment;
+    if (not options.skybox_root.empty()) {
+        std::vector<std::string> faces;
+        for (auto name: {"right", "left", "top", "bottom", "front", "back"}) {
+            faces.push_back(std::format("{}/{}.jpg", options.skybox_root, name));
+        }
+        environment = EnvironmentMap(ImageCache::instance().load(faces));
+        if (environment.empty()) {
+            std::cerr << std::format("skybox {} not found, the missed rays stay black\n", options.skybox_root);
+        }
+    }
+
+    // the references are taken once the vector no longer grows
+    std::vector<std::reference_wrapper<MeshModel>> mesh_models(models.begin(), models.end());
+
+    double load_time = seconds_since(load_start);
+
+    Camera camera(options.camera_position, glm::vec3(0, 1.0f, 0));
+
+    options.settings.progress = [](int finished, int total) {
+        std::cerr << std::format("\rray tracing {}/{} tiles", finished, total);
+    };
+
+    FrameBuffer framebuffer(options.width, options.height);
+    if (options.denoise) {
+        framebuffer.add_auxiliary_channels();
+    }
+
+    RenderStatistics statistics;
+    bool collect_statistics = not options.stats_path.empty() or not options.heatmap_path.empty();
+    if (collect_statistics) {
+        options.settings.statistics = &statistics;
+    }
+
+    auto render_start = std::chrono::steady_clock::now();
+    Scene scene(mesh_models, options.lights.empty() ? default_lights() : options.lights);
+    scene.light_samples = options.light_samples;
+    scene.environment = environment;
+    ray_tracing(camera, scene, framebuffer, options.settings);
+    double render_time = seconds_since(render_start);
+    std::cerr << std::endl;
+
+    double denoise_time = 0;
+    if (options.denoise) {
+        denoise_time = denoise(framebuffer, options.denoiser);
+        options.image_settings.channel = "denoised";
+    }
+
+    auto write_start = std::chrono::steady_clock::now();
+    bool written = write_image(framebuffer, options.output_path, options.image_settings);
+    double write_time = seconds_since(write_start);
+
+    if (not options.stats_path.empty()) {
+        std::ofstream stats_file(options.stats_path);
+        statistics.write_json(stats_file);
+        if (not stats_file) {
+            std::cerr << std::format("failed to write {}\n", options.stats_path);
+            written = false;
+        }
+    }
+
+    if (not options.heatmap_path.empty() and not write_image(cost_heatmap(framebuffer), options.heatmap_path)) {
+        written = false;
+    }
+
+    size_t triangle_count = 0;
+    for (auto &model: models) {
+        triangle_count += model.faces_indices.size();
+    }
+
+    double samples = 0;
+    for (int y = 0; y < framebuffer.height; y++) {
+        for (int x = 0; x < framebuffer.width; x++) {
+            samples += framebuffer.sample_count(x, y);
+        }
+    }
+
+    std::cout << std::format("models      {} ({} triangles)\n", models.size(), triangle_count)
+              << std::format("resolution  {}x{}, {} spp, {} threads\n", options.width, options.height,
+                             options.settings.samples_per_pixel, TileScheduler::resolve_thread_count(options.settings.thread_count))
+              << std::format("lights      {} ({} shadow rays per hit)\n", scene.lights.size(),
+                             std::min<size_t>(scene.lights.size(), std::clamp(scene.light_samples, 1, MAX_LIGHT_SAMPLES)))
+              << std::format("load        {:.3f} s\n", load_time)
+              << std::format("render      {:.3f} s ({:.2f} M samples/s, {:.2f} samples per pixel)\n", render_time,
+                             samples / render_time * 1e-6, samples / (double(options.width) * options.height));
+    if (collect_statistics) {
+        auto &counters = statistics.counters;
+        std::cout << std::format("rays        {:.2f} M ({:.2f} Mrays/s, {} primary, {} shadow, {} secondary)\n",
+                                 double(counters.rays()) * 1e-6, statistics.mrays_per_second(),
+                                 counters.primary_rays, counters.shadow_rays, counters.secondary_rays)
+                  << std::format("traversal   {:.1f} boxes, {:.1f} triangles, {:.1f} nodes per ray\n",
+                                 double(counters.box_tests) / double(std::max<uint64_t>(1, counters.rays())),
+                                 double(counters.triangle_tests) / double(std::max<uint64_t>(1, counters.rays())),
+                                 double(counters.nodes_visited) / double(std::max<uint64_t>(1, counters.rays())));
+    }
+    if (options.denoise) {
+        std::cout << std::format("denoise     {:.3f} s ({} iterations)\n", denoise_time, options.denoiser.iterations);
+    }
+    std::cout << std::format("write       {:.3f} s\n", write_time)
+              << std::format("output      {}\n", options.output_path);
+
+    return written ? 0 : 1;
+}